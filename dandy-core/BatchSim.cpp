@@ -0,0 +1,59 @@
+#include "BatchSim.h"
+
+#include <chrono>
+
+BatchSim::BatchSim(DWORD numGames, uint64_t seed, ThreadPool* pool)
+	: games(numGames), pool(pool), seed(seed), totalTicks(0), elapsedSeconds(0)
+{
+	Reset();
+}
+
+uint64_t BatchSim::GameSeed(uint64_t seed, DWORD index)
+{
+	return Random::Mix(seed + index * 0x9e3779b97f4a7c15ULL);
+}
+
+void BatchSim::Reset()
+{
+	pool->ParallelFor(NumGames(), kGrain, [this](DWORD begin, DWORD end)
+	{
+		for(DWORD i = begin; i < end; i++)
+		{
+			games[i] = Game();
+			games[i].Start(GameSeed(seed, i));
+		}
+	});
+	totalTicks = 0;
+	elapsedSeconds = 0;
+}
+
+void BatchSim::Step(const BYTE* buttons)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pool->ParallelFor(NumGames(), kGrain, [this, buttons](DWORD begin, DWORD end)
+	{
+		for(DWORD i = begin; i < end; i++)
+		{
+			Game& game = games[i];
+			const BYTE* pad = buttons + i * World::PlayerCount;
+			for(DWORD p = 0; p < World::PlayerCount; p++)
+			{
+				game.SetButtons(p, pad[p]);
+			}
+			game.Step();
+		}
+	});
+	elapsedSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	totalTicks += NumGames();
+}
+
+uint64_t BatchSim::Checksum() const
+{
+	uint64_t h = 14695981039346656037ULL;
+	for(DWORD i = 0; i < games.size(); i++)
+	{
+		uint64_t c = games[i].world.Checksum();
+		World::HashBytes(h, &c, sizeof(c));
+	}
+	return h;
+}
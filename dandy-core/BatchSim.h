@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Game.h"
+#include "ThreadPool.h"
+
+#include <vector>
+
+// Holds many independent games and steps them together on a ThreadPool.
+// Game i is seeded from (seed, i) alone, so the outcome of a batch depends
+// only on its seed and inputs, never on the number of threads.
+class BatchSim
+{
+public:
+	BatchSim(DWORD numGames, uint64_t seed, ThreadPool* pool);
+
+	DWORD NumGames() const
+	{
+		return (DWORD) games.size();
+	}
+
+	Game& GetGame(DWORD index)
+	{
+		return games[index];
+	}
+
+	// Restart every game from its seed.
+	void Reset();
+
+	// Advance every game by one tick. buttons holds World::PlayerCount
+	// GamePad::buttons values per game, game-major.
+	void Step(const BYTE* buttons);
+
+	// Combined checksum of all games, in game order.
+	uint64_t Checksum() const;
+
+	uint64_t TotalTicks() const
+	{
+		return totalTicks;
+	}
+
+	double ElapsedSeconds() const
+	{
+		return elapsedSeconds;
+	}
+
+	double TicksPerSecond() const
+	{
+		return elapsedSeconds > 0 ? totalTicks / elapsedSeconds : 0;
+	}
+
+	static uint64_t GameSeed(uint64_t seed, DWORD index);
+
+private:
+	std::vector<Game> games;
+	ThreadPool* pool;
+	uint64_t seed;
+	uint64_t totalTicks;
+	double elapsedSeconds;
+
+	// Games per task; large enough to amortize the deque traffic.
+	static const DWORD kGrain = 16;
+};
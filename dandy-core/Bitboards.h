@@ -0,0 +1,269 @@
+#pragma once
+
+#include "DandyTypes.h"
+#include "MapData.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline DWORD CountTrailingZeros64(uint64_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, v);
+	return (DWORD) index;
+#else
+	return (DWORD) __builtin_ctzll(v);
+#endif
+}
+
+inline DWORD PopCount64(uint64_t v)
+{
+#if defined(_MSC_VER)
+	return (DWORD) __popcnt64(v);
+#else
+	return (DWORD) __builtin_popcountll(v);
+#endif
+}
+
+enum BitPlane
+{
+	kPlaneWall,		// kWall, kLock
+	kPlaneExit,		// kUp, kDown
+	kPlanePickup,	// kKey .. kBomb, kHeart
+	kPlaneMonster,	// kGhost .. kBig
+	kPlaneGenerator,	// kGen1 .. kGen3
+	kPlaneArrow,	// kArrow0 .. kArrow7
+	kPlanePlayer,	// kPlayer0 .. kPlayer3
+	kNumPlanes,
+	kNoPlane = 0xff
+};
+
+// One bit per cell for each BitPlane, in the same row-major order as
+// Map::Cell. Questions about a category of cell over an area ("every
+// monster or generator in the active rectangle", "where is the first
+// exit") become a few 64-bit ANDs and bit scans per row instead of a test
+// per cell.
+template<DWORD Width, DWORD Height>
+class Bitboards
+{
+public:
+	static const DWORD kNumCells = Width * Height;
+	static const DWORD kNumWords = (kNumCells + 63) / 64;
+
+	static BitPlane PlaneOf(BYTE d)
+	{
+		static const BYTE kPlaneOf[kPlayer3 + 1] =
+		{
+			kNoPlane,	// kSpace
+			kPlaneWall,	// kWall
+			kPlaneWall,	// kLock
+			kPlaneExit,	// kUp
+			kPlaneExit,	// kDown
+			kPlanePickup,	// kKey
+			kPlanePickup,	// kFood
+			kPlanePickup,	// kMoney
+			kPlanePickup,	// kBomb
+			kPlaneMonster,	// kGhost
+			kPlaneMonster,	// kSmiley
+			kPlaneMonster,	// kBig
+			kPlanePickup,	// kHeart
+			kPlaneGenerator,	// kGen1
+			kPlaneGenerator,	// kGen2
+			kPlaneGenerator,	// kGen3
+			kPlaneArrow, kPlaneArrow, kPlaneArrow, kPlaneArrow,
+			kPlaneArrow, kPlaneArrow, kPlaneArrow, kPlaneArrow,
+			kPlanePlayer, kPlanePlayer, kPlanePlayer, kPlanePlayer
+		};
+		return (BitPlane) kPlaneOf[d];
+	}
+
+	static DWORD PlaneMask(BitPlane plane)
+	{
+		return 1u << plane;
+	}
+
+	void Rebuild(const BYTE* cells)
+	{
+		words.assign(kNumPlanes * kNumWords, 0);
+		for(DWORD i = 0; i < kNumCells; i++)
+		{
+			BitPlane plane = PlaneOf(cells[i]);
+			if(plane != kNoPlane)
+			{
+				Plane(plane)[i >> 6] |= 1ULL << (i & 63);
+			}
+		}
+	}
+
+	void Clear()
+	{
+		words.clear();
+	}
+
+	void Update(DWORD index, BYTE before, BYTE after)
+	{
+		BitPlane was = PlaneOf(before);
+		BitPlane is = PlaneOf(after);
+		if(was != is)
+		{
+			uint64_t bit = 1ULL << (index & 63);
+			if(was != kNoPlane)
+			{
+				Plane(was)[index >> 6] &= ~bit;
+			}
+			if(is != kNoPlane)
+			{
+				Plane(is)[index >> 6] |= bit;
+			}
+		}
+	}
+
+	bool Test(BitPlane plane, DWORD index) const
+	{
+		return (Plane(plane)[index >> 6] >> (index & 63)) & 1;
+	}
+
+	// Calls fn(index) for every cell in [left, right) x [top, bottom) that is
+	// on any plane in planeMask, in row-major order. fn may change the cells
+	// it is given.
+	template<class F>
+	void ForEachInRect(DWORD planeMask, DWORD left, DWORD top, DWORD right, DWORD bottom, const F& fn) const
+	{
+		Selection planes(*this, planeMask);
+		ForEachRow(left, top, right, bottom, [&](DWORD first, DWORD last)
+		{
+			for(DWORD w = first >> 6; w <= (last - 1) >> 6; w++)
+			{
+				uint64_t bits = planes.Gather(w) & SpanMask(w, first, last);
+				while(bits)
+				{
+					fn(w * 64 + CountTrailingZeros64(bits));
+					bits &= bits - 1;
+				}
+			}
+		});
+	}
+
+	DWORD CountInRect(DWORD planeMask, DWORD left, DWORD top, DWORD right, DWORD bottom) const
+	{
+		Selection planes(*this, planeMask);
+		DWORD count = 0;
+		ForEachRow(left, top, right, bottom, [&](DWORD first, DWORD last)
+		{
+			DWORD firstWord = first >> 6;
+			DWORD lastWord = (last - 1) >> 6;
+			count += PopCount64(planes.Gather(firstWord) & SpanMask(firstWord, first, last));
+			for(DWORD w = firstWord + 1; w < lastWord; w++)
+			{
+				count += PopCount64(planes.Gather(w));
+			}
+			if(lastWord != firstWord)
+			{
+				count += PopCount64(planes.Gather(lastWord) & SpanMask(lastWord, first, last));
+			}
+		});
+		return count;
+	}
+
+	// First cell holding value v, in row-major order, or false.
+	bool FindFirst(const BYTE* cells, BYTE v, DWORD& index) const
+	{
+		BitPlane plane = PlaneOf(v);
+		if(plane == kNoPlane)
+		{
+			return false;
+		}
+		const uint64_t* p = Plane(plane);
+		for(DWORD w = 0; w < kNumWords; w++)
+		{
+			uint64_t bits = p[w];
+			while(bits)
+			{
+				DWORD i = w * 64 + CountTrailingZeros64(bits);
+				if(cells[i] == v)
+				{
+					index = i;
+					return true;
+				}
+				bits &= bits - 1;
+			}
+		}
+		return false;
+	}
+
+private:
+	uint64_t* Plane(BitPlane plane)
+	{
+		return &words[plane * kNumWords];
+	}
+
+	const uint64_t* Plane(BitPlane plane) const
+	{
+		return &words[plane * kNumWords];
+	}
+
+	// The planes named by a mask, resolved once per query.
+	struct Selection
+	{
+		Selection(const Bitboards& boards, DWORD planeMask)
+		{
+			count = 0;
+			for(DWORD plane = 0; plane < kNumPlanes; plane++)
+			{
+				if(planeMask & (1u << plane))
+				{
+					planes[count++] = boards.Plane((BitPlane) plane);
+				}
+			}
+		}
+
+		uint64_t Gather(DWORD w) const
+		{
+			uint64_t bits = 0;
+			for(DWORD i = 0; i < count; i++)
+			{
+				bits |= planes[i][w];
+			}
+			return bits;
+		}
+
+		const uint64_t* planes[kNumPlanes];
+		DWORD count;
+	};
+
+	// Calls fn(first, last) with the cell range of each row of the rectangle,
+	// merging rows that span the whole width into one range.
+	template<class F>
+	static void ForEachRow(DWORD left, DWORD top, DWORD right, DWORD bottom, const F& fn)
+	{
+		if(left >= right || top >= bottom)
+		{
+			return;
+		}
+		if(left == 0 && right == Width)
+		{
+			fn(top * Width, bottom * Width);
+			return;
+		}
+		for(DWORD y = top; y < bottom; y++)
+		{
+			fn(y * Width + left, y * Width + right);
+		}
+	}
+
+	// Bits of word w that fall inside [first, last).
+	static uint64_t SpanMask(DWORD w, DWORD first, DWORD last)
+	{
+		DWORD lo = std::max(first, w * 64) - w * 64;
+		DWORD hi = std::min(last, w * 64 + 64) - w * 64;
+		uint64_t mask = hi == 64 ? ~0ULL : (1ULL << hi) - 1;
+		return mask & ~((1ULL << lo) - 1);
+	}
+
+	std::vector<uint64_t> words;
+};
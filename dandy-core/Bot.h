@@ -0,0 +1,387 @@
+#pragma once
+
+#include "Game.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <math.h>
+#include <vector>
+
+// A player driven by Monte Carlo tree search. Each decision saves the game
+// and searches over copies of it: the tree's edges are the bot's actions,
+// each held for ticksPerAction ticks, while the other players hold the
+// buttons they had when the search started. Leaves are played out with
+// random moves and shots and scored by what the bot's player gained and
+// how much nearer the exit (or, behind locks, a key) it got.
+//
+// The search is root-parallel: config.trees independent trees, each with
+// its own copy of the game and random stream, run on the pool and vote
+// with their root visit counts. Trees share nothing, so with an iteration
+// budget the choice depends only on the game, the seed and the number of
+// trees, never on the number of threads. A wall-clock budget stops every
+// tree at the deadline instead.
+template<class Rules>
+class MctsBotT
+{
+public:
+	typedef GameT<Rules> GameType;
+
+	// kDirUp .. kDirUpLeft, then the buttons.
+	static const DWORD kFire = 8;
+	static const DWORD kEat = 9;
+	static const DWORD kBomb = 10;
+	static const DWORD kNumActions = 11;
+
+	// Playouts only move and fire; food and bombs are spent in the tree,
+	// where the search can see what they bought.
+	static const DWORD kPlayoutActions = 9;
+
+	struct Config
+	{
+		Config()
+		{
+			iterations = 2000;
+			budgetMicros = 0;
+			trees = 1;
+			ticksPerAction = WorldT<Rules>::kTicksPerMove;
+			playoutActions = 10;
+			exploration = 0.3f;
+			seed = 1;
+		}
+
+		DWORD iterations;	// Per decision, over all trees
+		DWORD budgetMicros;	// Per decision; 0 for none
+		DWORD trees;
+		DWORD ticksPerAction;
+		DWORD playoutActions;
+		float exploration;	// UCT constant
+		uint64_t seed;
+	};
+
+	struct Stats
+	{
+		Stats()
+		{
+			Clear();
+		}
+
+		void Clear()
+		{
+			decisions = 0;
+			playouts = 0;
+			ticks = 0;
+			seconds = 0;
+		}
+
+		DWORD decisions;
+		uint64_t playouts;
+		uint64_t ticks;		// Ticks simulated by the search
+		double seconds;		// Wall time spent deciding
+	};
+
+	MctsBotT(DWORD newSlot, const Config& newConfig, ThreadPool* newPool)
+	{
+		slot = newSlot;
+		config = newConfig;
+		pool = newPool;
+		trees.resize(config.trees ? config.trees : 1);
+	}
+
+	static BYTE ActionButtons(DWORD action)
+	{
+		static const BYTE kButtons[kNumActions] =
+		{
+			GamePad::kUp, GamePad::kUp | GamePad::kRight, GamePad::kRight, GamePad::kDown | GamePad::kRight,
+			GamePad::kDown, GamePad::kDown | GamePad::kLeft, GamePad::kLeft, GamePad::kUp | GamePad::kLeft,
+			GamePad::kA, GamePad::kB, GamePad::kC
+		};
+		MyBoundsCheck(action < kNumActions);
+		return kButtons[action];
+	}
+
+	// Searches from game as it stands and returns the action to take.
+	DWORD Decide(GameType& game)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		deadline = start + std::chrono::microseconds(config.budgetMicros);
+		game.Save(root);
+		rootTick = game.world.tick;
+		rootLevel = game.world.level;
+		rootPlayer = game.world.player[slot];
+		FindExitDistances(game.world.map);
+		rootExitDistance = ExitDistance(rootPlayer);
+		for(DWORD i = 0; i < GameType::PlayerCount; i++)
+		{
+			heldButtons[i] = game.gamepad[i].buttons;
+		}
+
+		DWORD numTrees = (DWORD) trees.size();
+		DWORD decision = stats.decisions++;
+		auto search = [&](DWORD begin, DWORD end)
+		{
+			for(DWORD t = begin; t < end; t++)
+			{
+				// The first iterations % numTrees trees take one more. Rounding
+				// up by adding would wrap for the 0xffffffff of a time budget.
+				DWORD iterations = config.iterations / numTrees + (t < config.iterations % numTrees ? 1 : 0);
+				Search(trees[t], Random::Mix(config.seed + (uint64_t) decision * numTrees + t), game, iterations);
+			}
+		};
+		if(pool)
+		{
+			pool->ParallelFor(numTrees, 1, search);
+		}
+		else
+		{
+			search(0, numTrees);
+		}
+
+		DWORD best = 0;
+		uint64_t bestVisits = 0;
+		float bestValue = -1;
+		for(DWORD a = 0; a < kNumActions; a++)
+		{
+			uint64_t visits = 0;
+			float value = 0;
+			for(DWORD t = 0; t < numTrees; t++)
+			{
+				const Tree& tree = trees[t];
+				if(tree.nodes[0].firstChild)
+				{
+					const Node& child = tree.nodes[tree.nodes[0].firstChild + a];
+					visits += child.visits;
+					value += child.value;
+				}
+			}
+			float mean = visits ? value / visits : 0;
+			if(visits > bestVisits || (visits == bestVisits && mean > bestValue))
+			{
+				best = a;
+				bestVisits = visits;
+				bestValue = mean;
+			}
+		}
+		for(DWORD t = 0; t < numTrees; t++)
+		{
+			stats.playouts += trees[t].playouts;
+			stats.ticks += trees[t].ticks;
+		}
+		stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return best;
+	}
+
+	DWORD slot;
+	Config config;
+	Stats stats;
+
+private:
+	struct Node
+	{
+		DWORD firstChild;	// kNumActions children from here; 0 until expanded
+		DWORD visits;
+		float value;		// Sum of playout values
+	};
+
+	struct Tree
+	{
+		std::vector<Node> nodes;
+		GameType game;
+		Random rng;
+		uint64_t playouts;
+		uint64_t ticks;
+	};
+
+	void Search(Tree& tree, uint64_t seed, const GameType& game, DWORD iterations)
+	{
+		tree.nodes.clear();
+		Node rootNode = { 0, 0, 0 };
+		tree.nodes.push_back(rootNode);
+		tree.rng.Seed(seed);
+		tree.playouts = 0;
+		tree.ticks = 0;
+		tree.game.world.SetMonsterPathing(game.world.GetMonsterPathing());
+		DWORD path[256];
+		for(DWORD i = 0; i < iterations; i++)
+		{
+			if(config.budgetMicros && (i & 15) == 0 && std::chrono::steady_clock::now() >= deadline)
+			{
+				break;
+			}
+			tree.game.Restore(root);
+
+			// Select down to a leaf, expanding it if it has been played out
+			// before.
+			DWORD node = 0;
+			DWORD depth = 0;
+			path[depth++] = node;
+			bool over = false;
+			while(!over && depth < 256)
+			{
+				if(!tree.nodes[node].firstChild)
+				{
+					if(tree.nodes[node].visits == 0 && node != 0)
+					{
+						break;
+					}
+					tree.nodes[node].firstChild = (DWORD) tree.nodes.size();
+					Node child = { 0, 0, 0 };
+					tree.nodes.insert(tree.nodes.end(), kNumActions, child);
+				}
+				DWORD action = Select(tree, tree.nodes[node]);
+				node = tree.nodes[node].firstChild + action;
+				path[depth++] = node;
+				over = Act(tree, action);
+			}
+
+			float value = 0;
+			if(!over)
+			{
+				for(DWORD a = 0; a < config.playoutActions && !over; a++)
+				{
+					over = Act(tree, tree.rng.Get(kPlayoutActions));
+				}
+			}
+			value = Evaluate(tree.game.world);
+			for(DWORD d = 0; d < depth; d++)
+			{
+				Node& n = tree.nodes[path[d]];
+				++n.visits;
+				n.value += value;
+			}
+			++tree.playouts;
+		}
+	}
+
+	// UCT, trying every action once first.
+	DWORD Select(Tree& tree, const Node& parent) const
+	{
+		const Node* children = &tree.nodes[parent.firstChild];
+		float logVisits = logf((float) (parent.visits + 1));
+		DWORD best = 0;
+		float bestScore = -1;
+		for(DWORD a = 0; a < kNumActions; a++)
+		{
+			const Node& c = children[a];
+			if(c.visits == 0)
+			{
+				return a;
+			}
+			float score = c.value / c.visits + config.exploration * sqrtf(logVisits / c.visits);
+			if(score > bestScore)
+			{
+				best = a;
+				bestScore = score;
+			}
+		}
+		return best;
+	}
+
+	// Plays one action; returns true if the bot's game is over (dead, out
+	// of the level or restarted), so there is nothing more to search.
+	bool Act(Tree& tree, DWORD action)
+	{
+		GameType& g = tree.game;
+		for(DWORD t = 0; t < config.ticksPerAction; t++)
+		{
+			for(DWORD i = 0; i < GameType::PlayerCount; i++)
+			{
+				g.SetButtons(i, i == slot ? ActionButtons(action) : heldButtons[i]);
+			}
+			g.Step();
+			++tree.ticks;
+			const Player& p = g.world.player[slot];
+			if(!p.IsAlive() || p.state == kInWarp || g.world.level != rootLevel || g.world.tick < rootTick)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Moves from every cell to the nearest exit, through anything but walls
+	// (monsters die) and, unless the bot holds a key, locks, by a
+	// breadth-first search out from the exits. If the bot cannot reach an
+	// exit that way, it heads for the nearest key instead.
+	void FindExitDistances(const Map& map)
+	{
+		bool haveKey = rootPlayer.keys != 0;
+		if(!Flood(map, kDown, haveKey))
+		{
+			Flood(map, kKey, haveKey);
+		}
+	}
+
+	// Returns true if the bot's cell was reached.
+	bool Flood(const Map& map, MapData target, bool throughLocks)
+	{
+		WORD queue[Map::NumCells];
+		DWORD head = 0;
+		DWORD tail = 0;
+		for(DWORD i = 0; i < Map::NumCells; i++)
+		{
+			exitDistance[i] = kFar;
+			if(map.Cell[i] == target)
+			{
+				exitDistance[i] = 0;
+				queue[tail++] = (WORD) i;
+			}
+		}
+		while(head < tail)
+		{
+			DWORD index = queue[head++];
+			for(DWORD dir = 0; dir < 8; dir++)
+			{
+				DWORD next = index + Map::Step(dir);
+				BYTE d = map.Cell[next];
+				if(exitDistance[next] == kFar && d != kWall && (throughLocks || d != kLock))
+				{
+					exitDistance[next] = exitDistance[index] + 1;
+					queue[tail++] = (WORD) next;
+				}
+			}
+		}
+		return exitDistance[Map::Index(rootPlayer.x, rootPlayer.y)] != kFar;
+	}
+
+	DWORD ExitDistance(const Player& p) const
+	{
+		WORD d = exitDistance[Map::Index(p.x, p.y)];
+		return d == kFar ? 0 : d;
+	}
+
+	// 0 for a dead bot, 1 for reaching the exit, otherwise a half plus what
+	// the bot picked up and how much nearer the exit it got.
+	float Evaluate(const WorldT<Rules>& world) const
+	{
+		const Player& p = world.player[slot];
+		if(world.tick < rootTick || !p.IsAlive())
+		{
+			return 0;
+		}
+		if(p.state == kInWarp || world.level != rootLevel)
+		{
+			return 1;
+		}
+		float value = 0.5f
+			+ 0.003f * (float) (p.score - rootPlayer.score)
+			+ 0.05f * ((int) p.health - (int) rootPlayer.health)
+			+ 0.05f * ((int) p.food + p.keys + p.bombs - rootPlayer.food - rootPlayer.keys - rootPlayer.bombs)
+			+ 0.03f * ((int) rootExitDistance - (int) ExitDistance(p));
+		return value < 0 ? 0 : value > 1 ? 1 : value;
+	}
+
+	ThreadPool* pool;
+	std::vector<Tree> trees;
+	typename GameType::Snapshot root;
+	std::chrono::steady_clock::time_point deadline;
+	DWORD rootTick;
+	DWORD rootLevel;
+	Player rootPlayer;
+	static const WORD kFar = 0xffff;
+	WORD exitDistance[Map::NumCells];
+	DWORD rootExitDistance;
+	BYTE heldButtons[GameType::PlayerCount];
+};
+
+typedef MctsBotT<ClassicRules> MctsBot;
+typedef MctsBotT<Xbox360Rules> MctsBot360;
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "DandyTypes.h"
+
+// Little-endian integers in files and packets, independent of the host.
+
+inline DWORD Read16(const BYTE* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+inline DWORD Read32(const BYTE* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((DWORD) p[3] << 24);
+}
+
+inline void Write16(BYTE* p, DWORD v)
+{
+	p[0] = (BYTE) v;
+	p[1] = (BYTE) (v >> 8);
+}
+
+inline void Write32(BYTE* p, DWORD v)
+{
+	Write16(p, v);
+	Write16(p + 2, v >> 16);
+}
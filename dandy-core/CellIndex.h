@@ -0,0 +1,82 @@
+#pragma once
+
+#include "DandyTypes.h"
+#include "MapData.h"
+
+#include <string.h>
+
+// How many cells hold each MapData value, and where the first of them (in
+// row-major order) is, kept in step with every write so that Find and
+// counts do not scan the map.
+//
+// first[v] is only a lower bound: removing the first cell of a kind leaves
+// it where it was, and the next FindFirst walks on from there to the new
+// first cell and remembers it. Writing a cell of that kind ahead of the
+// bound moves it back, so the walks are not bounded per rebuild: a walk
+// after the first cell of a kind is removed can cost up to one pass over
+// the map, however often that happens. Find is cheap while the first cell
+// of the kind being looked for stays put.
+template<DWORD Width, DWORD Height>
+class CellIndex
+{
+public:
+	static const DWORD kNumCells = Width * Height;
+
+	void Rebuild(const BYTE* cells)
+	{
+		memset(count, 0, sizeof(count));
+		for(DWORD v = 0; v < kNumMapData; v++)
+		{
+			first[v] = kNumCells;
+		}
+		for(DWORD i = kNumCells; i-- > 0;)
+		{
+			++count[cells[i]];
+			first[cells[i]] = i;
+		}
+	}
+
+	void Update(DWORD index, BYTE before, BYTE after)
+	{
+		if(before == after)
+		{
+			return;
+		}
+		if(--count[before] == 0)
+		{
+			first[before] = kNumCells;
+		}
+		++count[after];
+		if(index < first[after])
+		{
+			first[after] = index;
+		}
+	}
+
+	DWORD Count(BYTE v) const
+	{
+		MyBoundsCheck(v < kNumMapData);
+		return count[v];
+	}
+
+	bool FindFirst(const BYTE* cells, BYTE v, DWORD& index)
+	{
+		MyBoundsCheck(v < kNumMapData);
+		if(count[v] == 0)
+		{
+			return false;
+		}
+		DWORD i = first[v];
+		while(cells[i] != v)
+		{
+			++i;
+		}
+		first[v] = i;
+		index = i;
+		return true;
+	}
+
+private:
+	DWORD count[kNumMapData];
+	DWORD first[kNumMapData];
+};
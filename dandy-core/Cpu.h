@@ -0,0 +1,63 @@
+#pragma once
+
+// Instruction set detection for the SIMD kernels (Nibbles.cpp, Planes.cpp).
+// Each kernel file compiles for the baseline target and marks its AVX2
+// functions with DANDY_TARGET_AVX2, then checks the CPU at run time.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DANDY_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define DANDY_X86 0
+#endif
+
+// GCC and Clang only emit AVX2 inside functions that ask for it; MSVC
+// accepts the intrinsics anywhere.
+#if DANDY_X86 && (defined(__GNUC__) || defined(__clang__))
+#define DANDY_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DANDY_TARGET_AVX2
+#endif
+
+#if DANDY_X86
+
+struct Cpu
+{
+	static bool HasAVX2()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if(info[0] < 7)
+		{
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		return avx2 && osxsave && (_xgetbv(0) & 6) == 6;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+	// SSE2 is part of x86-64, so only 32-bit builds need to ask.
+	static bool HasSSE2()
+	{
+#if defined(__x86_64__) || defined(_M_X64)
+		return true;
+#elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[3] & (1 << 26)) != 0;
+#else
+		return __builtin_cpu_supports("sse2");
+#endif
+	}
+};
+
+#endif
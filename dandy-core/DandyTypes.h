@@ -0,0 +1,55 @@
+#pragma once
+
+// Portable stand-ins for the Win32 types the game code was written against,
+// so the core builds on Linux as well as Windows.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+#endif
+
+inline void MyDebugBreak()
+{
+#if defined(_MSC_VER)
+	__debugbreak();
+#else
+	__builtin_trap();
+#endif
+}
+
+inline void MyAssert(bool test)
+{
+	if(!test)
+	{
+		MyDebugBreak();
+	}
+}
+
+// Map bounds checks are a compile-time policy: on in debug builds, compiled
+// out when NDEBUG is defined. Define DANDY_BOUNDS_CHECK as 0 or 1 to choose
+// explicitly.
+#ifndef DANDY_BOUNDS_CHECK
+#ifdef NDEBUG
+#define DANDY_BOUNDS_CHECK 0
+#else
+#define DANDY_BOUNDS_CHECK 1
+#endif
+#endif
+
+inline void MyBoundsCheck(bool test)
+{
+#if DANDY_BOUNDS_CHECK
+	MyAssert(test);
+#else
+	(void) test;
+#endif
+}
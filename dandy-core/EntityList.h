@@ -0,0 +1,87 @@
+#pragma once
+
+#include "DandyTypes.h"
+#include "MapData.h"
+#include "TileTraits.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+// Cell indices of every monster and generator on the map, bucketed by
+// (x % 3, y % 3). DoMonsters visits one cell in every 3x3 block per tick,
+// which is exactly one bucket, so a tick only looks at the entities it may
+// update instead of every lattice cell of the active region.
+//
+// Each bucket is kept sorted, which is the row-major order the old lattice
+// scan visited cells in, and lets a tick jump straight to the rows of the
+// active region. Indices are stored as WORDs when the map is small enough.
+template<DWORD Width, DWORD Height>
+class EntityList
+{
+public:
+	typedef typename std::conditional<Width * Height <= 0xffff, WORD, DWORD>::type Index;
+
+	static bool IsEntity(BYTE d)
+	{
+		return HasTrait(d, kTileEntity);
+	}
+
+	static DWORD BucketOf(DWORD index)
+	{
+		return (index % Width) % 3 + ((index / Width) % 3) * 3;
+	}
+
+	void Rebuild(const BYTE* cells)
+	{
+		for(DWORD b = 0; b < kNumBuckets; b++)
+		{
+			bucket[b].clear();
+		}
+		for(DWORD i = 0; i < Width * Height; i++)
+		{
+			if(IsEntity(cells[i]))
+			{
+				bucket[BucketOf(i)].push_back((Index) i);
+			}
+		}
+	}
+
+	void Update(DWORD index, BYTE before, BYTE after)
+	{
+		bool was = IsEntity(before);
+		bool is = IsEntity(after);
+		if(was != is)
+		{
+			std::vector<Index>& b = bucket[BucketOf(index)];
+			typename std::vector<Index>::iterator it = std::lower_bound(b.begin(), b.end(), (Index) index);
+			if(is)
+			{
+				b.insert(it, (Index) index);
+			}
+			else
+			{
+				b.erase(it);
+			}
+		}
+	}
+
+	const std::vector<Index>& Bucket(DWORD xClass, DWORD yClass) const
+	{
+		return bucket[xClass + yClass * 3];
+	}
+
+	DWORD Count() const
+	{
+		DWORD count = 0;
+		for(DWORD b = 0; b < kNumBuckets; b++)
+		{
+			count += (DWORD) bucket[b].size();
+		}
+		return count;
+	}
+
+private:
+	static const DWORD kNumBuckets = 9;
+	std::vector<Index> bucket[kNumBuckets];
+};
@@ -0,0 +1,208 @@
+#include "Env.h"
+#include "BatchSim.h"
+#include "ByteOrder.h"
+
+#include <string.h>
+
+static_assert(DANDY_ENV_MAP_WIDTH == Map::Width && DANDY_ENV_MAP_HEIGHT == Map::Height, "Env.h map size");
+static_assert(DANDY_ENV_MAX_AGENTS == World360::PlayerCount, "Env.h player count");
+static_assert(DANDY_ENV_OBSERVATION_SIZE >= Map::NumCells + World360::PlayerCount * DANDY_ENV_PLAYER_SIZE + 4
+	&& DANDY_ENV_OBSERVATION_SIZE % 16 == 0, "Env.h observation size");
+
+// What each agent had after the last step, to take rewards against.
+struct AgentState
+{
+	DWORD score;
+	BYTE health;
+};
+
+struct DandyEnv
+{
+	explicit DandyEnv(const DandyEnvConfig& newConfig)
+		: config(newConfig),
+		pool(newConfig.numThreads > 0 ? newConfig.numThreads - 1 : kThreadPoolAuto),
+		games(newConfig.numEnvs),
+		agents(newConfig.numEnvs * newConfig.numAgents),
+		episodes(newConfig.numEnvs, 0),
+		episodeTicks(newConfig.numEnvs, 0)
+	{
+		observations = NULL;
+		rewards = NULL;
+		dones = NULL;
+	}
+
+	void StartEpisode(DWORD index)
+	{
+		Game360& game = games[index];
+		for(DWORD i = 0; i < World360::PlayerCount; i++)
+		{
+			game.gamepad[i] = GamePad();
+			game.SetConnected(i, i < config.numAgents);
+		}
+		game.Start(BatchSim::GameSeed(config.seed, index) ^ Random::Mix(episodes[index]++));
+		episodeTicks[index] = 0;
+		// Agents join on their first step.
+		for(DWORD a = 0; a < config.numAgents; a++)
+		{
+			agents[index * config.numAgents + a].score = 0;
+			agents[index * config.numAgents + a].health = 0;
+		}
+	}
+
+	void Observe(DWORD index) const
+	{
+		const World360& world = games[index].world;
+		BYTE* out = observations + (size_t) index * DANDY_ENV_OBSERVATION_SIZE;
+		memcpy(out, world.map.Cell, Map::NumCells);
+		BYTE* p = out + Map::NumCells;
+		for(DWORD i = 0; i < World360::PlayerCount; i++, p += DANDY_ENV_PLAYER_SIZE)
+		{
+			const Player& pl = world.player[i];
+			p[0] = pl.x;
+			p[1] = pl.y;
+			p[2] = pl.health;
+			p[3] = pl.food;
+			p[4] = pl.keys;
+			p[5] = pl.bombs;
+			p[6] = (BYTE) pl.state;
+			p[7] = (BYTE) pl.dir;
+		}
+		memset(p, 0, out + DANDY_ENV_OBSERVATION_SIZE - p);
+		Write32(p, world.level);
+	}
+
+	void Step(DWORD index, const BYTE* actions)
+	{
+		static const BYTE kButtons[DANDY_ENV_NUM_ACTIONS] =
+		{
+			0,
+			GamePad::kUp, GamePad::kUp | GamePad::kRight, GamePad::kRight, GamePad::kDown | GamePad::kRight,
+			GamePad::kDown, GamePad::kDown | GamePad::kLeft, GamePad::kLeft, GamePad::kUp | GamePad::kLeft,
+			GamePad::kA, GamePad::kB, GamePad::kC
+		};
+		Game360& game = games[index];
+		const BYTE* action = actions + index * config.numAgents;
+		for(DWORD a = 0; a < config.numAgents; a++)
+		{
+			// Eat and bomb act on a new press, so release the pad first to
+			// make every step's action a press of its own.
+			game.SetButtons(a, 0);
+			game.SetButtons(a, action[a] < DANDY_ENV_NUM_ACTIONS ? kButtons[action[a]] : 0);
+		}
+		DWORD level = game.world.level;
+		// Step starts the game over once everyone is dead.
+		bool over = game.Step();
+		float levelReward = !over && game.world.level > level ? config.levelReward * (game.world.level - level) : 0;
+		float* reward = rewards + index * config.numAgents;
+		for(DWORD a = 0; a < config.numAgents; a++)
+		{
+			AgentState& before = agents[index * config.numAgents + a];
+			const Player& p = game.world.player[a];
+			float r = levelReward;
+			if(over)
+			{
+				r -= config.healthReward * before.health;
+			}
+			else
+			{
+				if(p.score > before.score)
+				{
+					r += config.moneyReward * ((p.score - before.score) / TraitsOf(kMoney).score);
+				}
+				// A dead agent rejoins at full health; that is not a reward.
+				if(before.health)
+				{
+					r += config.healthReward * ((int) p.health - (int) before.health);
+				}
+			}
+			reward[a] = r;
+			before.score = p.score;
+			before.health = p.health;
+		}
+
+		bool done = over || (config.maxTicks && ++episodeTicks[index] >= config.maxTicks);
+		if(done)
+		{
+			StartEpisode(index);
+		}
+		dones[index] = done ? 1 : 0;
+		Observe(index);
+	}
+
+	DandyEnvConfig config;
+	ThreadPool pool;
+	std::vector<Game360> games;
+	std::vector<AgentState> agents;
+	std::vector<uint64_t> episodes;
+	std::vector<DWORD> episodeTicks;
+	BYTE* observations;
+	float* rewards;
+	BYTE* dones;
+
+	// Environments per task.
+	static const DWORD kGrain = 16;
+};
+
+void DandyEnvDefaultConfig(DandyEnvConfig* config)
+{
+	config->numEnvs = 256;
+	config->numAgents = 1;
+	config->numThreads = 0;
+	config->maxTicks = 60 * 60 * 5;
+	config->seed = 1;
+	config->moneyReward = 1;
+	config->healthReward = 0.1f;
+	config->levelReward = 10;
+}
+
+DandyEnv* DandyEnvCreate(const DandyEnvConfig* config)
+{
+	if(!config || config->numEnvs == 0 || config->numAgents == 0 || config->numAgents > DANDY_ENV_MAX_AGENTS)
+	{
+		return NULL;
+	}
+	Map::PreloadLevels();
+	return new DandyEnv(*config);
+}
+
+void DandyEnvDestroy(DandyEnv* env)
+{
+	delete env;
+}
+
+void DandyEnvSetBuffers(DandyEnv* env, uint8_t* observations, float* rewards, uint8_t* dones)
+{
+	env->observations = observations;
+	env->rewards = rewards;
+	env->dones = dones;
+}
+
+void DandyEnvReset(DandyEnv* env)
+{
+	MyAssert(env->observations && env->rewards && env->dones);
+	env->pool.ParallelFor(env->config.numEnvs, DandyEnv::kGrain, [env](DWORD begin, DWORD end)
+	{
+		for(DWORD i = begin; i < end; i++)
+		{
+			env->episodes[i] = 0;
+			env->StartEpisode(i);
+			env->dones[i] = 0;
+			for(DWORD a = 0; a < env->config.numAgents; a++)
+			{
+				env->rewards[i * env->config.numAgents + a] = 0;
+			}
+			env->Observe(i);
+		}
+	});
+}
+
+void DandyEnvStep(DandyEnv* env, const uint8_t* actions)
+{
+	env->pool.ParallelFor(env->config.numEnvs, DandyEnv::kGrain, [env, actions](DWORD begin, DWORD end)
+	{
+		for(DWORD i = begin; i < end; i++)
+		{
+			env->Step(i, actions);
+		}
+	});
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+// C interface to a batch of games for reinforcement learning, callable
+// from any language with a C FFI (the dandyenv shared library).
+//
+// Every environment is an Xbox 360 rules game with numAgents players,
+// each driven by one action per step. The caller owns every buffer: Step
+// reads actions and writes observations, rewards and done flags straight
+// into the arrays given to DandyEnvSetBuffers, and nothing is allocated
+// after DandyEnvCreate.
+//
+//   actions       numEnvs * numAgents bytes, DANDY_ENV_ACTION_*
+//   observations  numEnvs * DANDY_ENV_OBSERVATION_SIZE bytes: the map cells
+//                 (MapData values, row-major), then for each of the four
+//                 players x, y, health, food, keys, bombs, state and
+//                 direction, then the level (32 bits, little-endian),
+//                 then padding
+//   rewards       numEnvs * numAgents floats
+//   dones         numEnvs bytes, 1 when that environment's episode ended
+//                 this step
+//
+// A reward is moneyReward per kMoney picked up (score / 10), healthReward
+// per point of health gained or lost while alive, and levelReward per
+// level advanced. An episode ends when every agent is dead or after
+// maxTicks steps; the environment then starts a new one at once, so the
+// observation returned with done set is the first of the next episode.
+
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(DANDY_ENV_EXPORTS)
+#define DANDY_ENV_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(DANDY_ENV_SHARED)
+#define DANDY_ENV_API __declspec(dllimport)
+#elif defined(__GNUC__)
+#define DANDY_ENV_API __attribute__((visibility("default")))
+#else
+#define DANDY_ENV_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum
+{
+	DANDY_ENV_ACTION_NONE,
+	DANDY_ENV_ACTION_UP,			// Then clockwise, as Direction
+	DANDY_ENV_ACTION_UP_RIGHT,
+	DANDY_ENV_ACTION_RIGHT,
+	DANDY_ENV_ACTION_DOWN_RIGHT,
+	DANDY_ENV_ACTION_DOWN,
+	DANDY_ENV_ACTION_DOWN_LEFT,
+	DANDY_ENV_ACTION_LEFT,
+	DANDY_ENV_ACTION_UP_LEFT,
+	DANDY_ENV_ACTION_FIRE,
+	DANDY_ENV_ACTION_EAT,			// Each step counts as a new press, so
+	DANDY_ENV_ACTION_BOMB,			// sending one twice in a row acts twice
+	DANDY_ENV_NUM_ACTIONS
+};
+
+enum
+{
+	DANDY_ENV_MAP_WIDTH = 60,
+	DANDY_ENV_MAP_HEIGHT = 30,
+	DANDY_ENV_MAX_AGENTS = 4,
+	DANDY_ENV_PLAYER_SIZE = 8,
+	DANDY_ENV_OBSERVATION_SIZE = 1840
+};
+
+typedef struct DandyEnvConfig
+{
+	uint32_t numEnvs;
+	uint32_t numAgents;		// 1 to DANDY_ENV_MAX_AGENTS
+	uint32_t numThreads;	// Including the caller's; 0 for one per core
+	uint32_t maxTicks;		// Per episode; 0 for no limit
+	uint64_t seed;
+	float moneyReward;
+	float healthReward;
+	float levelReward;
+} DandyEnvConfig;
+
+typedef struct DandyEnv DandyEnv;
+
+DANDY_ENV_API void DandyEnvDefaultConfig(DandyEnvConfig* config);
+
+// NULL if the config is out of range.
+DANDY_ENV_API DandyEnv* DandyEnvCreate(const DandyEnvConfig* config);
+DANDY_ENV_API void DandyEnvDestroy(DandyEnv* env);
+
+// Must be called before Reset and Step; the buffers must outlive them.
+DANDY_ENV_API void DandyEnvSetBuffers(DandyEnv* env, uint8_t* observations, float* rewards, uint8_t* dones);
+
+// Starts a new episode in every environment and writes its observations;
+// rewards and dones are zeroed.
+DANDY_ENV_API void DandyEnvReset(DandyEnv* env);
+
+DANDY_ENV_API void DandyEnvStep(DandyEnv* env, const uint8_t* actions);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Map.h"
+
+#include <string.h>
+
+// Breadth-first flow field over the active region, grown from every visible
+// player at once. After at most one Build per tick, the way from any cell
+// towards the nearest reachable player is a single lookup, and the route
+// goes around walls, locks and items instead of straight at the player.
+//
+// Cells monsters can move through (or will vacate) are open: space, arrows,
+// players and other monsters. Everything else blocks. The region is copied
+// into a grid with a blocked border and a fixed stride, so the search needs
+// no bounds checks or divisions.
+//
+// Monsters and arrows moving around never change which cells are open, so
+// Update only rebuilds when the players, the region or Map::pathVersion
+// changed since the last build. Players stand at Coord coordinates.
+template<DWORD MaxWidth, DWORD MaxHeight, class Coord = BYTE>
+class FlowField
+{
+public:
+	FlowField()
+	{
+		left = top = width = height = 0;
+		valid = false;
+		memset(mark, kBlocked, sizeof(mark));
+	}
+
+	template<class MapType>
+	void Update(const MapType& map, DWORD regionLeft, DWORD regionTop, DWORD regionRight, DWORD regionBottom,
+		const Coord* sourceX, const Coord* sourceY, DWORD numSources)
+	{
+		bool current = valid && map.pathVersion == builtVersion && numSources == builtSources
+			&& regionLeft == left && regionTop == top
+			&& std::min(regionRight - regionLeft, MaxWidth) == width
+			&& std::min(regionBottom - regionTop, MaxHeight) == height;
+		for(DWORD i = 0; current && i < numSources; i++)
+		{
+			current = sourceX[i] == builtX[i] && sourceY[i] == builtY[i];
+		}
+		if(!current)
+		{
+			Build(map, regionLeft, regionTop, regionRight, regionBottom, sourceX, sourceY, numSources);
+		}
+	}
+
+	template<class MapType>
+	void Build(const MapType& map, DWORD regionLeft, DWORD regionTop, DWORD regionRight, DWORD regionBottom,
+		const Coord* sourceX, const Coord* sourceY, DWORD numSources)
+	{
+		static const int kDelta[8] =
+		{
+			-(int) kStride, 1 - (int) kStride, 1, 1 + (int) kStride,
+			(int) kStride, (int) kStride - 1, -1, -1 - (int) kStride
+		};
+
+		valid = numSources <= kMaxSources;
+		builtVersion = map.pathVersion;
+		builtSources = numSources;
+		for(DWORD i = 0; i < numSources && valid; i++)
+		{
+			builtX[i] = sourceX[i];
+			builtY[i] = sourceY[i];
+		}
+		left = regionLeft;
+		top = regionTop;
+		width = std::min(regionRight - regionLeft, MaxWidth);
+		height = std::min(regionBottom - regionTop, MaxHeight);
+
+		memset(mark, kBlocked, kStride * (height + 2));
+		for(DWORD y = 0; y < height; y++)
+		{
+			const BYTE* row = &map.Cell[left + (top + y) * MapType::Width];
+			BYTE* out = &mark[(y + 1) * kStride + 1];
+			for(DWORD x = 0; x < width; x++)
+			{
+				out[x] = IsMonsterPath(row[x]) ? kOpen : kBlocked;
+			}
+		}
+
+		DWORD head = 0;
+		DWORD tail = 0;
+		for(DWORD i = 0; i < numSources; i++)
+		{
+			DWORD sx = sourceX[i] - left;
+			DWORD sy = sourceY[i] - top;
+			if(sx < width && sy < height)
+			{
+				DWORD s = (sy + 1) * kStride + sx + 1;
+				if(mark[s] == kOpen)
+				{
+					mark[s] = kReached;
+					dir[s] = kDirNone;
+					queue[tail++] = (WORD) s;
+				}
+			}
+		}
+
+		while(head < tail)
+		{
+			DWORD c = queue[head++];
+			for(DWORD k = 0; k < 8; k++)
+			{
+				DWORD n = c + kDelta[k];
+				if(mark[n] == kOpen)
+				{
+					mark[n] = kReached;
+					dir[n] = (BYTE) ((k + 4) & 7); // Back towards c
+					queue[tail++] = (WORD) n;
+				}
+			}
+		}
+	}
+
+	// Direction to step from (x, y) towards the nearest player, or kDirNone
+	// if the cell is outside the region or no player can be reached from it.
+	Direction Get(DWORD x, DWORD y) const
+	{
+		DWORD fx = x - left;
+		DWORD fy = y - top;
+		if(fx < width && fy < height)
+		{
+			DWORD f = (fy + 1) * kStride + fx + 1;
+			if(mark[f] == kReached)
+			{
+				return (Direction) dir[f];
+			}
+		}
+		return kDirNone;
+	}
+
+	static const DWORD kMaxSources = 4;
+
+private:
+	static const DWORD kStride = MaxWidth + 2;
+	static const DWORD kCells = kStride * (MaxHeight + 2);
+	static const BYTE kBlocked = 0;
+	static const BYTE kOpen = 1;
+	static const BYTE kReached = 2;
+
+	bool valid;
+	DWORD builtVersion;
+	DWORD builtSources;
+	Coord builtX[kMaxSources];
+	Coord builtY[kMaxSources];
+
+	DWORD left;
+	DWORD top;
+	DWORD width;
+	DWORD height;
+	BYTE mark[kCells];
+	BYTE dir[kCells];
+	WORD queue[kCells];
+};
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "World.h"
+
+class GamePad
+{
+public:
+	GamePad()
+	{
+		buttons = 0;
+		strobe = 0;
+	}
+
+	// Latch a new button state, remembering which buttons were newly pressed.
+	void SetButtons(BYTE newButtons)
+	{
+		strobe = newButtons & ~buttons;
+		buttons = newButtons;
+	}
+
+	static const int kUp = 1; // Mask for up button
+	static const int kDown = 2;
+	static const int kLeft = 4;
+	static const int kRight = 8;
+	static const int kA = 16;
+	static const int kB = 32;
+	static const int kC = 64;
+	static const int kD = 128;
+	BYTE buttons;	// bit set if button is currently pressed down
+	BYTE strobe;	// bit set if button is newly pressed down
+};
+
+// Headless version of the game loop: a World plus the pads that drive it.
+// Callers feed one button state per player per tick and call Step().
+template<class Rules, class Geometry = ClassicGeometry>
+class GameT
+{
+public:
+	GameT()
+	{
+		for(DWORD i = 0; i < PlayerCount; i++)
+		{
+			connected[i] = false;
+		}
+		Init();
+	}
+
+	// The world plus the pad state the next Step reads.
+	struct Snapshot
+	{
+		typename WorldT<Rules, Geometry>::Snapshot world;
+		GamePad gamepad[WorldT<Rules, Geometry>::PlayerCount];
+		bool connected[WorldT<Rules, Geometry>::PlayerCount];
+	};
+
+	void Init()
+	{
+		world.Init();
+	}
+
+	void Start()
+	{
+		Init();
+		world.LoadLevel(0);
+	}
+
+	void Start(uint64_t seed)
+	{
+		world.Seed(seed);
+		Start();
+	}
+
+	void SetButtons(DWORD index, BYTE buttons)
+	{
+		if(index < PlayerCount)
+		{
+			gamepad[index].SetButtons(buttons);
+		}
+		else
+		{
+			MyDebugBreak();
+		}
+	}
+
+	// With hot-join rules, a connected pad whose player is not alive joins
+	// (or rejoins) on the next Step, and a disconnected pad's player dies.
+	void SetConnected(DWORD index, bool isConnected)
+	{
+		if(index < PlayerCount)
+		{
+			connected[index] = isConnected;
+		}
+		else
+		{
+			MyDebugBreak();
+		}
+	}
+
+	// Plays one tick. True if it ended the game, which has then started
+	// over at the first level.
+	bool Step()
+	{
+		if constexpr(Rules::kHotJoin)
+		{
+			JoinPlayers();
+		}
+		world.Update();
+		MovePlayers();
+		bool over = world.IsGameOver();
+		if(over)
+		{
+			Start();
+		}
+#if DANDY_VERIFY_HASH
+		MyAssert(world.map.VerifyHash());
+#endif
+		return over;
+	}
+
+	void MovePlayers()
+	{
+		for(DWORD i = 0; i < world.numPlayers; i++)
+		{
+			GamePad* pPad = & gamepad[i];
+			static const Direction kPadToDir[] =
+			{
+				// Bitfield is Right Left Down Up
+				// Directions are clockwise from up == 0
+				kDirNone, // 0000
+				kDirUp, // 0001
+				kDirDown, // 0010
+				kDirNone, // 0011
+				kDirLeft, // 0100
+				kDirUpLeft, // 0101
+				kDirDownLeft, // 0110
+				kDirLeft, // 0111
+				kDirRight, // 1000
+				kDirUpRight, // 1001
+				kDirDownRight, // 1010
+				kDirRight, // 1011
+				kDirNone, // 1100
+				kDirUp, // 1101
+				kDirDown, // 1110
+				kDirNone, // 1111
+			};
+			Direction dir = kPadToDir[0xf & pPad->buttons];
+			if(dir != kDirNone)
+			{
+				world.Move(i, dir);
+			}
+
+			// Handle strobes
+			if(pPad->buttons & GamePad::kA)
+			{
+				world.Fire(i);
+			}
+			if(pPad->strobe & GamePad::kB)
+			{
+				world.EatFood(i);
+			}
+			if(pPad->strobe & GamePad::kC)
+			{
+				world.UseSmartBomb(i);
+			}
+
+			if(pPad->strobe & GamePad::kD)
+			{
+				if(i == 0)
+				{
+					world.ChangeLevel(1); // For debugging
+				}
+			}
+		}
+	}
+
+	DWORD Save(Snapshot& snapshot)
+	{
+		for(DWORD i = 0; i < PlayerCount; i++)
+		{
+			snapshot.gamepad[i] = gamepad[i];
+			snapshot.connected[i] = connected[i];
+		}
+		return world.Save(snapshot.world);
+	}
+
+	void Restore(const Snapshot& snapshot)
+	{
+		for(DWORD i = 0; i < PlayerCount; i++)
+		{
+			gamepad[i] = snapshot.gamepad[i];
+			connected[i] = snapshot.connected[i];
+		}
+		world.Restore(snapshot.world);
+	}
+
+	void JoinPlayers()
+	{
+		for(DWORD i = 0; i < PlayerCount; i++)
+		{
+			bool alive = world.player[i].IsAlive();
+			if(connected[i] && !alive)
+			{
+				world.AddPlayer(i);
+			}
+			else if(!connected[i] && alive)
+			{
+				world.KillPlayer(i);
+			}
+		}
+	}
+
+	static const DWORD PlayerCount = WorldT<Rules, Geometry>::PlayerCount;
+	WorldT<Rules, Geometry> world;
+	GamePad gamepad[PlayerCount];
+	bool connected[PlayerCount];
+};
+
+typedef GameT<ClassicRules> Game;
+typedef GameT<Xbox360Rules> Game360;
@@ -0,0 +1,262 @@
+#include "LevelArchive.h"
+#include "ByteOrder.h"
+#include "Map.h"
+
+#include <string.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static DWORD Hash32(const BYTE* data, DWORD size)
+{
+	DWORD h = 2166136261u;
+	for(DWORD i = 0; i < size; i++)
+	{
+		h = (h ^ data[i]) * 16777619u;
+	}
+	return h;
+}
+
+static const char kMagic[4] = { 'D', 'L', 'V', 'A' };
+
+LevelArchive::LevelArchive()
+{
+	base = NULL;
+	size = 0;
+	count = 0;
+	tableOffset = 0;
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#endif
+}
+
+LevelArchive::~LevelArchive()
+{
+	Close();
+}
+
+bool LevelArchive::Open(const char* path)
+{
+	Close();
+#ifdef _WIN32
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size = (size_t) fileSize.QuadPart;
+	mapping = size ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	base = mapping ? (const BYTE*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+	int fd = open(path, O_RDONLY);
+	if(fd < 0)
+	{
+		return false;
+	}
+	struct stat st;
+	if(fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		size = (size_t) st.st_size;
+		void* p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		base = p == MAP_FAILED ? NULL : (const BYTE*) p;
+	}
+	close(fd);
+#endif
+	if(!base)
+	{
+		Close();
+		return false;
+	}
+
+	bool ok = size >= kHeaderSize && !memcmp(base, kMagic, sizeof(kMagic))
+		&& Read32(base + 4) == kVersion
+		&& Read16(base + 12) == Map::Width && Read16(base + 14) == Map::Height
+		&& Read32(base + 16) == Map::PackedLevelSize
+		&& Read32(base + 24) == kEntrySize;
+	if(ok)
+	{
+		count = Read32(base + 8);
+		tableOffset = Read32(base + 20);
+		ok = tableOffset <= size && count <= (size - tableOffset) / kEntrySize;
+	}
+	for(DWORD i = 0; ok && i < count; i++)
+	{
+		DWORD offset = Read32(Entry(i));
+		DWORD levelSize = Read32(Entry(i) + 4);
+		ok = levelSize == Map::PackedLevelSize && offset <= size && levelSize <= size - offset
+			&& IsPlayable(GetInfo(i));
+	}
+	if(!ok)
+	{
+		Close();
+	}
+	return ok;
+}
+
+void LevelArchive::Close()
+{
+#ifdef _WIN32
+	if(base)
+	{
+		UnmapViewOfFile(base);
+	}
+	if(mapping)
+	{
+		CloseHandle(mapping);
+	}
+	if(file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+	}
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#else
+	if(base)
+	{
+		munmap((void*) base, size);
+	}
+#endif
+	base = NULL;
+	size = 0;
+	count = 0;
+	tableOffset = 0;
+}
+
+const BYTE* LevelArchive::GetPacked(DWORD index) const
+{
+	MyBoundsCheck(index < count);
+	return base + Read32(Entry(index));
+}
+
+LevelInfo LevelArchive::GetInfo(DWORD index) const
+{
+	MyBoundsCheck(index < count);
+	const BYTE* e = Entry(index);
+	LevelInfo info;
+	info.offset = Read32(e);
+	info.size = Read32(e + 4);
+	info.hash = Read32(e + 8);
+	info.upX = e[12];
+	info.upY = e[13];
+	info.downX = e[14];
+	info.downY = e[15];
+	info.monsters = (WORD) Read16(e + 16);
+	info.generators = (WORD) Read16(e + 18);
+	info.pickups = (WORD) Read16(e + 20);
+	info.locks = (WORD) Read16(e + 22);
+	memcpy(info.name, e + 24, kNameSize);
+	info.name[kNameSize] = 0;
+	return info;
+}
+
+bool LevelArchive::Verify(DWORD index) const
+{
+	MyBoundsCheck(index < count);
+	return Hash32(GetPacked(index), Map::PackedLevelSize) == Read32(Entry(index) + 8);
+}
+
+void LevelArchive::Describe(const BYTE* cells, LevelInfo& info)
+{
+	info.upX = info.upY = info.downX = info.downY = 0xff;
+	info.monsters = info.generators = info.pickups = info.locks = 0;
+	for(DWORD i = 0; i < Map::NumCells; i++)
+	{
+		BYTE d = cells[i];
+		if(d == kUp && info.upX == 0xff)
+		{
+			info.upX = (BYTE) (i % Map::Width);
+			info.upY = (BYTE) (i / Map::Width);
+		}
+		else if(d == kDown && info.downX == 0xff)
+		{
+			info.downX = (BYTE) (i % Map::Width);
+			info.downY = (BYTE) (i / Map::Width);
+		}
+		else if(d >= kGhost && d <= kBig)
+		{
+			++info.monsters;
+		}
+		else if(d >= kGen1 && d <= kGen3)
+		{
+			++info.generators;
+		}
+		else if((d >= kKey && d <= kBomb) || d == kHeart)
+		{
+			++info.pickups;
+		}
+		else if(d == kLock)
+		{
+			++info.locks;
+		}
+	}
+}
+
+bool LevelArchive::IsPlayable(const LevelInfo& info)
+{
+	return (info.upX > 0 && info.upY > 0 && info.upX < Map::Width - 1 && info.upY < Map::Height - 1);
+}
+
+bool LevelArchive::Write(const char* path, const BYTE* packed, const char* const* names, DWORD count)
+{
+	const DWORD stride = (Map::PackedLevelSize + kDataAlign - 1) / kDataAlign * kDataAlign;
+	const DWORD dataOffset = (kHeaderSize + count * kEntrySize + kDataAlign - 1) / kDataAlign * kDataAlign;
+	std::vector<BYTE> head(dataOffset, 0);
+	memcpy(&head[0], kMagic, sizeof(kMagic));
+	Write32(&head[4], kVersion);
+	Write32(&head[8], count);
+	Write16(&head[12], Map::Width);
+	Write16(&head[14], Map::Height);
+	Write32(&head[16], Map::PackedLevelSize);
+	Write32(&head[20], kHeaderSize);
+	Write32(&head[24], kEntrySize);
+
+	BYTE cells[Map::NumCells];
+	for(DWORD i = 0; i < count; i++)
+	{
+		const BYTE* level = packed + i * Map::PackedLevelSize;
+		LevelInfo info;
+		Map::DecodeLevel(level, cells);
+		Describe(cells, info);
+		BYTE* e = &head[kHeaderSize + i * kEntrySize];
+		Write32(e, dataOffset + i * stride);
+		Write32(e + 4, Map::PackedLevelSize);
+		Write32(e + 8, Hash32(level, Map::PackedLevelSize));
+		e[12] = info.upX;
+		e[13] = info.upY;
+		e[14] = info.downX;
+		e[15] = info.downY;
+		Write16(e + 16, info.monsters);
+		Write16(e + 18, info.generators);
+		Write16(e + 20, info.pickups);
+		Write16(e + 22, info.locks);
+		if(names && names[i])
+		{
+			strncpy((char*) e + 24, names[i], kNameSize);
+		}
+	}
+
+	FILE* out = fopen(path, "wb");
+	if(!out)
+	{
+		return false;
+	}
+	bool ok = fwrite(&head[0], 1, head.size(), out) == head.size();
+	static const BYTE kPad[kDataAlign] = { 0 };
+	for(DWORD i = 0; ok && i < count; i++)
+	{
+		ok = fwrite(packed + i * Map::PackedLevelSize, 1, Map::PackedLevelSize, out) == Map::PackedLevelSize
+			&& fwrite(kPad, 1, stride - Map::PackedLevelSize, out) == stride - Map::PackedLevelSize;
+	}
+	ok = fclose(out) == 0 && ok;
+	return ok;
+}
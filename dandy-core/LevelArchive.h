@@ -0,0 +1,105 @@
+#pragma once
+
+#include "DandyTypes.h"
+
+#include <stdio.h>
+
+// A single file holding any number of levels, read through a memory
+// mapping so that opening it costs nothing per level and a level is
+// decoded straight out of the mapped pages.
+//
+// Layout, all integers little-endian:
+//
+//   header   32 bytes   "DLVA", version, level count, map width and
+//                       height, packed level size, offset and entry size
+//                       of the level table
+//   table    count entries of kEntrySize bytes, one per level: data
+//            offset and size, FNV-1a hash of the data, metadata (see
+//            LevelInfo) and a name
+//   data     each level's packed cells (two per byte, low nibble first,
+//            as in the level.* files), starting on a 64-byte boundary
+//
+// Built by dandy-pack from a directory of level files.
+
+struct LevelInfo
+{
+	DWORD offset;
+	DWORD size;
+	DWORD hash;
+	BYTE upX;	// 0xff if the level has no kUp
+	BYTE upY;
+	BYTE downX;	// 0xff if the level has no kDown
+	BYTE downY;
+	WORD monsters;
+	WORD generators;
+	WORD pickups;
+	WORD locks;
+	char name[25];
+};
+
+class LevelArchive
+{
+public:
+	LevelArchive();
+	~LevelArchive();
+
+	// Maps the archive and checks the header and table. Fails on anything
+	// that does not match this build's map size, or on a level that is not
+	// IsPlayable.
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const
+	{
+		return base != NULL;
+	}
+
+	DWORD Count() const
+	{
+		return count;
+	}
+
+	// Packed cells of a level, pointing into the mapping.
+	const BYTE* GetPacked(DWORD index) const;
+	LevelInfo GetInfo(DWORD index) const;
+
+	// True if a level's data still matches the hash in its table entry.
+	bool Verify(DWORD index) const;
+
+	// Fills the metadata fields of info from decoded cells.
+	static void Describe(const BYTE* cells, LevelInfo& info);
+
+	// False if the level has no kUp, or has it on the outer ring, which the
+	// game turns to wall: players start next to kUp and must not start on
+	// the ring. Open refuses archives holding such a level, and dandy-pack
+	// will not pack one.
+	static bool IsPlayable(const LevelInfo& info);
+
+	// Writes count levels, PackedLevelSize bytes each and back to back in
+	// packed, to a new archive. names may be NULL.
+	static bool Write(const char* path, const BYTE* packed, const char* const* names, DWORD count);
+
+	static const DWORD kVersion = 1;
+	static const DWORD kHeaderSize = 32;
+	static const DWORD kEntrySize = 48;
+	static const DWORD kNameSize = 24;
+	static const DWORD kDataAlign = 64;
+
+private:
+	LevelArchive(const LevelArchive&);
+	LevelArchive& operator=(const LevelArchive&);
+
+	const BYTE* Entry(DWORD index) const
+	{
+		return base + tableOffset + index * kEntrySize;
+	}
+
+	const BYTE* base;
+	size_t size;
+	DWORD count;
+	DWORD tableOffset;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#endif
+};
@@ -0,0 +1,63 @@
+#include "Loopback.h"
+
+LoopbackNetwork::LoopbackNetwork(DWORD numEndpoints, uint64_t seed)
+	: inbox(numEndpoints), rng(seed)
+{
+	sent = 0;
+	dropped = 0;
+	delivered = 0;
+	now = 0;
+	latency = 0;
+	jitter = 0;
+	loss = 0;
+}
+
+void LoopbackNetwork::SetLatency(DWORD latencyMicros, DWORD jitterMicros)
+{
+	latency = latencyMicros;
+	jitter = jitterMicros;
+}
+
+void LoopbackNetwork::SetLoss(DWORD lossPercent)
+{
+	loss = lossPercent;
+}
+
+void LoopbackNetwork::Send(DWORD from, DWORD to, const BYTE* data, DWORD size)
+{
+	MyAssert(to < inbox.size());
+	++sent;
+	if(loss && rng.Get(100) < loss)
+	{
+		++dropped;
+		return;
+	}
+	Datagram d;
+	d.due = now + latency + (jitter ? rng.Get(jitter + 1) : 0);
+	d.from = from;
+	d.data.assign(data, data + size);
+	inbox[to].push_back(d);
+}
+
+bool LoopbackNetwork::Receive(DWORD to, std::vector<BYTE>& data, DWORD& from)
+{
+	MyAssert(to < inbox.size());
+	std::vector<Datagram>& queue = inbox[to];
+	size_t best = queue.size();
+	for(size_t i = 0; i < queue.size(); i++)
+	{
+		if(queue[i].due <= now && (best == queue.size() || queue[i].due < queue[best].due))
+		{
+			best = i;
+		}
+	}
+	if(best == queue.size())
+	{
+		return false;
+	}
+	data.swap(queue[best].data);
+	from = queue[best].from;
+	queue.erase(queue.begin() + best);
+	++delivered;
+	return true;
+}
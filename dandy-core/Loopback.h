@@ -0,0 +1,54 @@
+#pragma once
+
+#include "DandyTypes.h"
+#include "Random.h"
+
+#include <vector>
+
+// In-process stand-in for a UDP network between numbered endpoints, for
+// testing netcode without sockets. Like UDP, a datagram may be dropped,
+// delayed or overtaken by a later one: each is delivered after the link
+// latency plus a random jitter, or lost with the given probability. Time
+// is a clock the caller advances, so a run is reproducible from its seed.
+class LoopbackNetwork
+{
+public:
+	LoopbackNetwork(DWORD numEndpoints, uint64_t seed);
+
+	void SetLatency(DWORD latencyMicros, DWORD jitterMicros);
+	void SetLoss(DWORD lossPercent);
+
+	void Advance(DWORD micros)
+	{
+		now += micros;
+	}
+
+	uint64_t Now() const
+	{
+		return now;
+	}
+
+	void Send(DWORD from, DWORD to, const BYTE* data, DWORD size);
+
+	// Takes the earliest datagram for this endpoint that is due by now.
+	bool Receive(DWORD to, std::vector<BYTE>& data, DWORD& from);
+
+	DWORD sent;
+	DWORD dropped;
+	DWORD delivered;
+
+private:
+	struct Datagram
+	{
+		uint64_t due;
+		DWORD from;
+		std::vector<BYTE> data;
+	};
+
+	std::vector<std::vector<Datagram> > inbox;
+	Random rng;
+	uint64_t now;
+	DWORD latency;
+	DWORD jitter;
+	DWORD loss;
+};
@@ -0,0 +1,112 @@
+#include "Map.h"
+#include "LevelArchive.h"
+
+#include <atomic>
+#include <mutex>
+#include <string.h>
+
+#ifndef DANDY_LEVEL_DIR
+#define DANDY_LEVEL_DIR "levels"
+#endif
+
+static char gLevelDirectory[1024] = DANDY_LEVEL_DIR;
+
+// Every level, decoded once. Worlds on any thread copy from here, so after
+// PreloadLevels a level change never touches the file system.
+static std::mutex gLevelCacheMutex;
+static std::atomic<bool> gLevelCacheLoaded(false);
+static bool gLevelCached[MapLevels::NumLevels];
+static BYTE gLevelCells[MapLevels::NumLevels][MapLevels::LevelCells];
+
+static std::atomic<const LevelArchive*> gLevelArchive(NULL);
+
+void MapLevels::SetLevelDirectory(const char* path)
+{
+	std::lock_guard<std::mutex> guard(gLevelCacheMutex);
+	strncpy(gLevelDirectory, path, sizeof(gLevelDirectory) - 1);
+	gLevelDirectory[sizeof(gLevelDirectory) - 1] = 0;
+	gLevelCacheLoaded.store(false, std::memory_order_release);
+}
+
+FILE* MapLevels::OpenLevelFile(DWORD index)
+{
+	const char* kSearchPath[] = { gLevelDirectory, "levels", "../levels" };
+	char fileName[1100];
+	FILE* in = NULL;
+	for(size_t i = 0; i < sizeof(kSearchPath) / sizeof(kSearchPath[0]) && in == NULL; i++)
+	{
+		snprintf(fileName, sizeof(fileName), "%s/level.%c", kSearchPath[i], (char) (index + 'a'));
+		in = fopen(fileName, "rb");
+	}
+	return in;
+}
+
+bool MapLevels::ReadLevelFile(DWORD index, BYTE* cells)
+{
+	FILE* in = OpenLevelFile(index);
+	if(!in)
+	{
+		return false;
+	}
+	BYTE packed[PackedLevelSize];
+	bool ok = fread(packed, 1, sizeof(packed), in) == sizeof(packed);
+	fclose(in);
+	if(ok)
+	{
+		DecodeLevel(packed, cells);
+		SealLevelBorder(cells);
+	}
+	return ok;
+}
+
+void MapLevels::PreloadLevels()
+{
+	std::lock_guard<std::mutex> guard(gLevelCacheMutex);
+	if(!gLevelCacheLoaded.load(std::memory_order_acquire))
+	{
+		for(DWORD i = 0; i < NumLevels; i++)
+		{
+			gLevelCached[i] = ReadLevelFile(i, gLevelCells[i]);
+		}
+		gLevelCacheLoaded.store(true, std::memory_order_release);
+	}
+}
+
+const BYTE* MapLevels::GetLevelCells(DWORD index)
+{
+	if(!gLevelCacheLoaded.load(std::memory_order_acquire))
+	{
+		PreloadLevels();
+	}
+	return index < NumLevels && gLevelCached[index] ? gLevelCells[index] : NULL;
+}
+
+void MapLevels::SetLevelArchive(const LevelArchive* archive)
+{
+	gLevelArchive.store(archive, std::memory_order_release);
+}
+
+const LevelArchive* MapLevels::GetLevelArchive()
+{
+	return gLevelArchive.load(std::memory_order_acquire);
+}
+
+DWORD MapLevels::LevelCount()
+{
+	const LevelArchive* archive = GetLevelArchive();
+	return archive ? archive->Count() : NumLevels;
+}
+
+void MapLevels::SealLevelBorder(BYTE* cells)
+{
+	for(DWORD x = 0; x < LevelWidth; x++)
+	{
+		cells[x] = kWall;
+		cells[x + (LevelHeight - 1) * LevelWidth] = kWall;
+	}
+	for(DWORD y = 0; y < LevelHeight; y++)
+	{
+		cells[y * LevelWidth] = kWall;
+		cells[LevelWidth - 1 + y * LevelWidth] = kWall;
+	}
+}
@@ -0,0 +1,767 @@
+#pragma once
+
+#include "Bitboards.h"
+#include "CellIndex.h"
+#include "DandyTypes.h"
+#include "EntityList.h"
+#include "LevelArchive.h"
+#include "MapData.h"
+#include "MapGeometry.h"
+#include "MapSnapshot.h"
+#include "Nibbles.h"
+#include "RayTables.h"
+#include "RowMask.h"
+#include "TileTraits.h"
+#include "Zobrist.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// One cell write, as recorded by Map::SetDeferred.
+struct CellChange
+{
+	DWORD index;
+	BYTE before;
+	BYTE after;
+};
+
+// The shipped levels (or an archive's) and where they are read from.
+// Levels are 60x30 whatever the size of the map they are played on.
+class MapLevels
+{
+public:
+	// Levels are looked up in this directory first, then in "levels" and
+	// "../levels" relative to the working directory. Changing it empties
+	// the level cache.
+	static void SetLevelDirectory(const char* path);
+	static FILE* OpenLevelFile(DWORD index);
+
+	// Level files hold two cells per byte, low nibble first.
+	static void DecodeLevel(const BYTE* packed, BYTE* cells)
+	{
+		UnpackNibbles(packed, cells, PackedLevelSize);
+	}
+
+	// Decodes count levels stored back to back, PackedLevelSize bytes each,
+	// into count consecutive LevelCells arrays. For bulk checks of level
+	// collections; the cells are not border-sealed.
+	static void DecodeLevels(const BYTE* packed, BYTE* cells, DWORD count)
+	{
+		UnpackNibbles(packed, cells, PackedLevelSize * count);
+	}
+
+	// Reads and decodes one level file straight from disk.
+	static bool ReadLevelFile(DWORD index, BYTE* cells);
+
+	// Reads every level into the level cache. LoadLevel does this on first
+	// use; calling it at startup keeps file I/O off the game thread.
+	static void PreloadLevels();
+
+	// Decoded cells of a level from the cache, or NULL if it is missing.
+	static const BYTE* GetLevelCells(DWORD index);
+
+	// While an archive is set, LoadLevel(index) plays its levels instead of
+	// the level files. It must stay open until it is unset with NULL.
+	static void SetLevelArchive(const LevelArchive* archive);
+	static const LevelArchive* GetLevelArchive();
+
+	// Number of levels LoadLevel(index) can play.
+	static DWORD LevelCount();
+
+	// Levels are drawn with a wall border already; this makes sure of it.
+	static void SealLevelBorder(BYTE* cells);
+
+	const static DWORD LevelWidth = ClassicGeometry::kWidth;
+	const static DWORD LevelHeight = ClassicGeometry::kHeight;
+	const static DWORD LevelCells = LevelWidth * LevelHeight;
+	const static DWORD NumLevels = 26;
+	const static DWORD PackedLevelSize = LevelCells / 2;
+};
+
+// The cells of a map, and everything kept in step with them. Geometry (see
+// MapGeometry.h) sets the size at compile time; Map is the classic 60x30.
+template<class Geometry>
+class MapT : public MapLevels
+{
+public:
+	typedef typename Geometry::Coord Coord;
+
+	MapT()
+	{
+		pathVersion = 0;
+		bitboardsEnabled = false;
+		raysEnabled = false;
+		lockLabels = kLocksUnlabelled;
+		dirtyRows.Clear();
+		Init();
+	}
+
+	MapData Get(DWORD x, DWORD y) const
+	{
+		MyBoundsCheck(x < Width && y < Height);
+		return (MapData) Cell[x + y*Width];
+	}
+
+	MapData GetIndex(DWORD index) const
+	{
+		MyBoundsCheck(index < NumCells);
+		return (MapData) Cell[index];
+	}
+
+	void Set(DWORD x, DWORD y, int v)
+	{
+		MyBoundsCheck(x < Width && y < Height);
+		SetIndex(x + y*Width, (BYTE) v);
+	}
+
+	void SetIndex(DWORD index, BYTE v)
+	{
+		MyBoundsCheck(index < NumCells && v <= kPlayer3 && (v == kWall || !IsBorder(index)));
+		BYTE before = Cell[index];
+		Cell[index] = v;
+		OnCellChanged(index, before, v);
+	}
+
+	// Like SetIndex, but only writes the cell and appends the change to log.
+	// Used by threads that each own a disjoint part of the map; the owner of
+	// the map replays the logs through ApplyChanges once they are done.
+	void SetDeferred(DWORD index, int v, std::vector<CellChange>& log)
+	{
+		MyBoundsCheck(index < NumCells && v <= kPlayer3 && (v == kWall || !IsBorder(index)));
+		CellChange change;
+		change.index = index;
+		change.before = Cell[index];
+		change.after = (BYTE) v;
+		Cell[index] = change.after;
+		log.push_back(change);
+	}
+
+	void ApplyChanges(const std::vector<CellChange>& log)
+	{
+		for(size_t i = 0; i < log.size(); i++)
+		{
+			OnCellChanged(log[i].index, log[i].before, log[i].after);
+		}
+	}
+
+	// Keeps everything derived from Cell in step with a single write.
+	void OnCellChanged(DWORD index, BYTE before, BYTE after)
+	{
+		entities.Update(index, before, after);
+		cellIndex.Update(index, before, after);
+		if(bitboardsEnabled)
+		{
+			bitboards.Update(index, before, after);
+		}
+		if(raysEnabled)
+		{
+			rays.Update(Cell, index, before, after);
+		}
+		if(IsMonsterPath(before) != IsMonsterPath(after))
+		{
+			++pathVersion;
+		}
+		if((before == kLock || after == kLock) && lockLabels == kLocksLabelled)
+		{
+			OnLockChanged(index, after == kLock);
+		}
+		dirtyRows.Set(index / Width);
+		hash ^= Zobrist::Cell(index, before) ^ Zobrist::Cell(index, after);
+	}
+
+	// Rebuilds everything derived from Cell after a bulk write.
+	void OnCellsReplaced()
+	{
+		entities.Rebuild(Cell);
+		cellIndex.Rebuild(Cell);
+		if(bitboardsEnabled)
+		{
+			bitboards.Rebuild(Cell);
+		}
+		if(raysEnabled)
+		{
+			rays.Rebuild(Cell);
+		}
+		lockLabels = kLocksUnlabelled;
+		++pathVersion;
+		dirtyRows.SetAll();
+		hash = Zobrist::Cells(Cell, NumCells);
+	}
+
+	// True if the incremental hash agrees with one computed from scratch.
+	bool VerifyHash() const
+	{
+		return hash == Zobrist::Cells(Cell, NumCells);
+	}
+
+	// Bitboards cost a little on every write, so they are off unless a
+	// caller asks for them.
+	void EnableBitboards(bool enable)
+	{
+		bitboardsEnabled = enable;
+		if(enable)
+		{
+			bitboards.Rebuild(Cell);
+		}
+		else
+		{
+			bitboards.Clear();
+		}
+	}
+
+	// Ray tables (for RaySensors) cost a walk along eight lines whenever a
+	// cell empties or fills, so they are off unless a caller asks for them.
+	void EnableRays(bool enable)
+	{
+		raysEnabled = enable;
+		if(enable)
+		{
+			rays.Rebuild(Cell);
+		}
+		else
+		{
+			rays.Clear();
+		}
+	}
+
+	// The first cell holding v in row-major order.
+	bool Find(Coord& rx, Coord& ry, MapData v)
+	{
+		DWORD index;
+		if(!cellIndex.FindFirst(Cell, (BYTE) v, index))
+		{
+			return false;
+		}
+		rx = (Coord) (index % Width);
+		ry = (Coord) (index / Width);
+		return true;
+	}
+
+	// How many cells hold v, or any of first to last (kGen1 to kGen3 for
+	// the generators left, say).
+	DWORD Count(MapData v) const
+	{
+		return cellIndex.Count((BYTE) v);
+	}
+
+	DWORD CountRange(MapData first, MapData last) const
+	{
+		DWORD n = 0;
+		for(DWORD v = first; v <= last; v++)
+		{
+			n += cellIndex.Count((BYTE) v);
+		}
+		return n;
+	}
+
+	void OpenLock(DWORD x, DWORD y)
+	{
+		OpenLockIndex(x + y * Width);
+	}
+
+	// Opens the door index is part of: every lock 8-connected to it. The
+	// first door opened after a level loads labels all of them (LabelLocks),
+	// so a door is then a list of cells to clear. A door that is not whole
+	// (a snapshot restored half of it, say) is filled instead (OpenLockFill),
+	// and so is every door once a lock appears where none was labelled,
+	// until the next OnCellsReplaced.
+	void OpenLockIndex(DWORD index)
+	{
+		if(Cell[index] != kLock)
+		{
+			return;
+		}
+		if(lockLabels == kLocksUnlabelled)
+		{
+			LabelLocks();
+		}
+		DWORD door = lockComponent[index];
+		if(lockLabels == kLocksModified || lockPresent[door] != lockStart[door + 1] - lockStart[door])
+		{
+			OpenLockFill(index);
+			return;
+		}
+		for(DWORD i = lockStart[door]; i < lockStart[door + 1]; i++)
+		{
+			SetIndex(lockCells[i], kSpace);
+		}
+	}
+
+	// Keeps count of each labelled door's locks, so that restoring a
+	// snapshot from before a door was opened puts it back whole.
+	void OnLockChanged(DWORD index, bool added)
+	{
+		DWORD door = lockComponent[index];
+		if(door == kNoDoor)
+		{
+			lockLabels = kLocksModified;
+		}
+		else if(added)
+		{
+			++lockPresent[door];
+		}
+		else
+		{
+			--lockPresent[door];
+		}
+	}
+
+	// Groups the lock cells into doors with union-find over one pass of
+	// the map.
+	void LabelLocks();
+	static DWORD FindLockRoot(DWORD* parent, DWORD i);
+
+	// Opens a door by a scanline fill with an explicit stack: clears the
+	// run of locks along a row, then seeds the runs above and below that
+	// touch it, diagonals included. The border is never a lock, so the fill
+	// cannot leave the map.
+	void OpenLockFill(DWORD index);
+
+	static DWORD Index(DWORD x, DWORD y)
+	{
+		return x + y * Width;
+	}
+
+	// Linear offset of the neighbour in direction dir (kDirOffsets order).
+	// Every cell a player, arrow or monster can stand on is inside the wall
+	// border, so index + Step(dir) is always on the map.
+	static int Step(DWORD dir)
+	{
+		static const int kStep[8] =
+		{
+			-(int) Width, 1 - (int) Width, 1, (int) Width + 1,
+			(int) Width, (int) Width - 1, -1, -1 - (int) Width
+		};
+		MyBoundsCheck(dir < 8);
+		return kStep[dir];
+	}
+
+	static bool IsBorder(DWORD index)
+	{
+		DWORD x = index % Width;
+		DWORD y = index / Width;
+		return x == 0 || y == 0 || x == Width - 1 || y == Height - 1;
+	}
+
+	// The outer ring of every map is wall. Levels already are drawn that
+	// way; this makes it an invariant the movement code can rely on.
+	static void SealBorder(BYTE* cells)
+	{
+		for(DWORD x = 0; x < Width; x++)
+		{
+			cells[x] = kWall;
+			cells[x + (Height - 1) * Width] = kWall;
+		}
+		for(DWORD y = 0; y < Height; y++)
+		{
+			cells[y * Width] = kWall;
+			cells[Width - 1 + y * Width] = kWall;
+		}
+	}
+
+	void Init()
+	{
+		for(DWORD y = 0; y < Height; y++)
+		{
+			for(DWORD x = 0; x < Width; x++)
+			{
+				BYTE b = kSpace;
+				if(y == 0 || y == Height-1 || x == 0 || x == Width - 1)
+				{
+					b = kWall;
+				}
+				else if ( x == 2 && y == 2)
+				{
+					b = kUp;
+				}
+				else if ( x == 10 && y == 10 )
+				{
+					b = kDown;
+				}
+				Cell[y*Width+x] = b;
+			}
+		}
+		OnCellsReplaced();
+	}
+
+	// Copies a decoded level out of the level cache, or decodes it from the
+	// level archive if one is set. Falls back to the default map if the
+	// level could not be read. A map bigger than a level gets copies of it
+	// (PlaceLevel).
+	bool LoadLevel(DWORD index)
+	{
+		const LevelArchive* archive = GetLevelArchive();
+		if(archive)
+		{
+			return LoadLevel(*archive, index);
+		}
+		const BYTE* cells = GetLevelCells(index);
+		if(!cells)
+		{
+			Init();
+			return false;
+		}
+		PlaceLevel(cells);
+		OnCellsReplaced();
+		return true;
+	}
+
+	// Decodes a level straight out of the archive's mapped pages.
+	bool LoadLevel(const LevelArchive& archive, DWORD index)
+	{
+		if(index >= archive.Count())
+		{
+			Init();
+			return false;
+		}
+		if constexpr(kLevelSized)
+		{
+			DecodeLevel(archive.GetPacked(index), Cell);
+			SealLevelBorder(Cell);
+		}
+		else
+		{
+			BYTE cells[LevelCells];
+			DecodeLevel(archive.GetPacked(index), cells);
+			SealLevelBorder(cells);
+			PlaceLevel(cells);
+		}
+		OnCellsReplaced();
+		return true;
+	}
+
+	// Copies a level's cells onto Cell: as they are on a map the size of a
+	// level, and on a bigger one tiled from the top left, one copy per
+	// LevelWidth x LevelHeight block, with wall where no whole copy fits.
+	// Each copy keeps its wall ring, so they are separate rooms.
+	void PlaceLevel(const BYTE* cells)
+	{
+		if constexpr(kLevelSized)
+		{
+			memcpy(Cell, cells, NumCells);
+		}
+		else
+		{
+			memset(Cell, kWall, NumCells);
+			for(DWORD top = 0; top + LevelHeight <= Height; top += LevelHeight)
+			{
+				for(DWORD left = 0; left + LevelWidth <= Width; left += LevelWidth)
+				{
+					for(DWORD y = 0; y < LevelHeight; y++)
+					{
+						memcpy(Cell + left + (top + y) * Width, cells + y * LevelWidth, LevelWidth);
+					}
+				}
+			}
+		}
+	}
+
+	void GetActive(float& x, float& y, DWORD& left, DWORD& top, DWORD& right, DWORD& bottom)
+	{
+		GetActive1(x, left, right, Width, ViewWidth);
+		GetActive1(y, top, bottom, Height, ViewHeight);
+	}
+
+	void GetActive1(float& x, DWORD& left, DWORD& right, DWORD width, DWORD viewWidth)
+	{
+		x -= (viewWidth / 2.0f);
+		x = std::max(x, 0.f);
+		x = std::min(x, (float) (width - viewWidth));
+		left = (DWORD) x;
+		right = std::min(left + viewWidth + 1, width);
+	}
+
+	const static DWORD Width = Geometry::kWidth;
+	const static DWORD Height = Geometry::kHeight;
+	const static DWORD NumCells = Width * Height;
+	const static bool kLevelSized = Width == LevelWidth && Height == LevelHeight;
+	BYTE Cell[NumCells];
+
+	const static DWORD ViewWidth = Geometry::kViewWidth;
+	const static DWORD ViewHeight = Geometry::kViewHeight;
+
+	// Bumped whenever a cell starts or stops blocking monster paths.
+	DWORD pathVersion;
+
+	// Zobrist hash of Cell, kept in step by Set.
+	uint64_t hash;
+
+	// Monsters and generators, kept in step by Set.
+	typedef typename EntityList<Width, Height>::Index EntityIndex;
+	EntityList<Width, Height> entities;
+
+	// Count and first cell of each MapData value, kept in step by Set.
+	CellIndex<Width, Height> cellIndex;
+
+	// Per-category cell planes, kept in step by Set while enabled.
+	typedef Bitboards<Width, Height> CellBitboards;
+	bool bitboardsEnabled;
+	CellBitboards bitboards;
+
+	// Distances to the first occupied cell in each direction, kept in step
+	// by Set while enabled.
+	typedef RayTables<Width, Height> CellRays;
+	bool raysEnabled;
+	CellRays rays;
+
+	// Doors found by LabelLocks: the lock cells of door c are
+	// lockCells[lockStart[c]] to lockCells[lockStart[c + 1] - 1], and
+	// lockComponent gives the door of each cell (kNoDoor if it was not a
+	// lock). lockPresent counts the cells of each door that are locks now.
+	enum LockLabels
+	{
+		kLocksUnlabelled,	// Since the last OnCellsReplaced
+		kLocksLabelled,
+		kLocksModified		// A lock was added where none was labelled
+	};
+	static const DWORD kNoDoor = 0xffffffff;
+	LockLabels lockLabels;
+	std::vector<DWORD> lockComponent;
+	std::vector<DWORD> lockPresent;
+	std::vector<DWORD> lockStart;
+	std::vector<DWORD> lockCells;
+	std::vector<DWORD> lockScratch;	// Union-find parents, or the fill's stack
+
+	// Rows written since the last Save or Restore, and the snapshot that
+	// was saved or restored then.
+	typedef MapSnapshot<Width, Height> Snapshot;
+	RowMask<Height> dirtyRows;
+	Snapshot baseline;
+
+	// Saves Cell into snapshot. Rows not written since the last Save or
+	// Restore are shared with that snapshot rather than copied. Returns the
+	// number of rows copied.
+	DWORD Save(Snapshot& snapshot)
+	{
+		DWORD copied = 0;
+		for(DWORD row = 0; row < Height; row++)
+		{
+			if(dirtyRows.Test(row) || !baseline.Get(row))
+			{
+				baseline.Copy(row, Cell + row * Width);
+				++copied;
+			}
+		}
+		dirtyRows.Clear();
+		snapshot = baseline;
+		return copied;
+	}
+
+	// Puts back the cells of a snapshot taken from this or any other map.
+	// Only rows that were written since the last Save or Restore, or that
+	// the snapshot does not share with it, are looked at; a few changed
+	// cells go through OnCellChanged, a mostly different map is copied
+	// whole and rebuilt.
+	void Restore(const Snapshot& snapshot)
+	{
+		MyAssert(!snapshot.IsEmpty());
+		RowMask<Height> rows = dirtyRows;
+		for(DWORD row = 0; row < Height; row++)
+		{
+			if(snapshot.Get(row) != baseline.Get(row))
+			{
+				rows.Set(row);
+				baseline.Share(row, snapshot.Get(row));
+			}
+		}
+		if(rows.Count() > Height / 2)
+		{
+			for(DWORD row = 0; row < Height; row++)
+			{
+				memcpy(Cell + row * Width, snapshot.Get(row)->cells, Width);
+			}
+			OnCellsReplaced();
+		}
+		else
+		{
+			rows.ForEach([&](DWORD row)
+			{
+				const BYTE* saved = snapshot.Get(row)->cells;
+				if(memcmp(Cell + row * Width, saved, Width) != 0)
+				{
+					RestoreCells(row * Width, saved, Width);
+				}
+			});
+		}
+		dirtyRows.Clear();
+	}
+
+	// Writes the cells of a saved row that differ from Cell, eight at a
+	// time, so that a row with one changed cell costs about as much as
+	// copying it.
+	void RestoreCells(DWORD index, const BYTE* saved, DWORD count)
+	{
+		BYTE* cells = Cell + index;
+		DWORD x = 0;
+		for(; x + 8 <= count; x += 8)
+		{
+			uint64_t a;
+			uint64_t b;
+			memcpy(&a, cells + x, 8);
+			memcpy(&b, saved + x, 8);
+			if(a != b)
+			{
+				RestoreCellRun(index + x, saved + x, 8);
+			}
+		}
+		RestoreCellRun(index + x, saved + x, count - x);
+	}
+
+	void RestoreCellRun(DWORD index, const BYTE* saved, DWORD count)
+	{
+		for(DWORD i = 0; i < count; i++)
+		{
+			BYTE before = Cell[index + i];
+			if(before != saved[i])
+			{
+				Cell[index + i] = saved[i];
+				OnCellChanged(index + i, before, saved[i]);
+			}
+		}
+	}
+
+};
+
+template<class Geometry>
+const DWORD MapT<Geometry>::kNoDoor;
+
+template<class Geometry>
+DWORD MapT<Geometry>::FindLockRoot(DWORD* parent, DWORD i)
+{
+	while(parent[i] != i)
+	{
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+template<class Geometry>
+void MapT<Geometry>::LabelLocks()
+{
+	// Each lock joins the locks before it in the pass: north, or else
+	// west or north-west (which touch each other) and north-east. Both of
+	// the others touch north, so it alone will do. The border is never a
+	// lock, so they are all on the map.
+	lockScratch.resize(NumCells);
+	lockComponent.assign(NumCells, kNoDoor);
+	DWORD* parent = &lockScratch[0];
+	DWORD numLocks = 0;
+	for(DWORD i = Width; i < NumCells - Width; i++)
+	{
+		if(Cell[i] != kLock)
+		{
+			continue;
+		}
+		++numLocks;
+		if(Cell[i - Width] == kLock)
+		{
+			parent[i] = FindLockRoot(parent, i - Width);
+			continue;
+		}
+		DWORD west = Cell[i - 1] == kLock ? i - 1 : Cell[i - Width - 1] == kLock ? i - Width - 1 : kNoDoor;
+		DWORD northEast = Cell[i - Width + 1] == kLock ? i - Width + 1 : kNoDoor;
+		if(west == kNoDoor && northEast == kNoDoor)
+		{
+			parent[i] = i;
+			continue;
+		}
+		DWORD a = FindLockRoot(parent, west != kNoDoor ? west : northEast);
+		parent[i] = a;
+		if(west != kNoDoor && northEast != kNoDoor)
+		{
+			DWORD b = FindLockRoot(parent, northEast);
+			if(a != b)
+			{
+				parent[std::max(a, b)] = std::min(a, b);
+			}
+		}
+	}
+
+	// Number the doors in the order their first cells come, and list their
+	// cells by counting sort.
+	DWORD numDoors = 0;
+	lockStart.assign(1, 0);
+	for(DWORD i = Width; i < NumCells - Width; i++)
+	{
+		if(Cell[i] == kLock)
+		{
+			DWORD root = FindLockRoot(parent, i);
+			if(lockComponent[root] == kNoDoor)
+			{
+				lockComponent[root] = numDoors++;
+				lockStart.push_back(0);
+			}
+			lockComponent[i] = lockComponent[root];
+			++lockStart[lockComponent[i] + 1];
+		}
+	}
+	for(DWORD c = 0; c < numDoors; c++)
+	{
+		lockStart[c + 1] += lockStart[c];
+	}
+	lockPresent.resize(numDoors);
+	for(DWORD c = 0; c < numDoors; c++)
+	{
+		lockPresent[c] = lockStart[c + 1] - lockStart[c];
+	}
+	lockCells.resize(numLocks);
+	DWORD* next = parent;
+	memcpy(next, &lockStart[0], numDoors * sizeof(DWORD));
+	for(DWORD i = Width; i < NumCells - Width; i++)
+	{
+		if(Cell[i] == kLock)
+		{
+			lockCells[next[lockComponent[i]]++] = i;
+		}
+	}
+	lockLabels = kLocksLabelled;
+}
+
+template<class Geometry>
+void MapT<Geometry>::OpenLockFill(DWORD index)
+{
+	std::vector<DWORD>& stack = lockScratch;
+	stack.clear();
+	stack.push_back(index);
+	// Seeds the first cell of each run of locks in [first, last].
+	auto seedRuns = [&](DWORD first, DWORD last)
+	{
+		for(DWORD i = first; i <= last; i++)
+		{
+			if(Cell[i] == kLock && (i == first || Cell[i - 1] != kLock))
+			{
+				stack.push_back(i);
+			}
+		}
+	};
+	while(!stack.empty())
+	{
+		DWORD seed = stack.back();
+		stack.pop_back();
+		if(Cell[seed] != kLock)
+		{
+			continue;
+		}
+		DWORD left = seed;
+		DWORD right = seed;
+		while(Cell[left - 1] == kLock)
+		{
+			--left;
+		}
+		while(Cell[right + 1] == kLock)
+		{
+			++right;
+		}
+		for(DWORD i = left; i <= right; i++)
+		{
+			SetIndex(i, kSpace);
+		}
+		seedRuns(left - 1 - Width, right + 1 - Width);
+		seedRuns(left - 1 + Width, right + 1 + Width);
+	}
+}
+
+typedef MapT<ClassicGeometry> Map;
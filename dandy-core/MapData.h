@@ -0,0 +1,65 @@
+#pragma once
+
+enum Direction
+{
+	kDirUp,
+	kDirUpRight,
+	kDirRight,
+	kDirDownRight,
+	kDirDown,
+	kDirDownLeft,
+	kDirLeft,
+	kDirUpLeft,
+	kDirNone = 0xff
+};
+
+// Up is zero, clockwise
+const signed char kDirOffsets[8][2] =
+{
+	{0,-1},{1,-1},{1,0},{1,1},{0,1},{-1,1},{-1,0},{-1,-1}
+};
+
+inline bool IsDiagonal(Direction dir)
+{
+	return (((int) dir) & 1) != 0;
+}
+
+// Angle is expressed in 1/8ths of a circle
+inline Direction RotateBy(Direction dir, int angle)
+{
+	return (Direction) (0x7 & (((int) dir) + angle));
+}
+
+enum MapData
+{
+	kSpace,
+	kWall,
+	kLock,
+	kUp,
+	kDown,
+	kKey,
+	kFood,
+	kMoney,
+	kBomb,
+	kGhost,
+	kSmiley,
+	kBig,
+	kHeart,
+	kGen1,
+	kGen2,
+	kGen3,
+	kArrow0, // Down-left arrow
+	kArrow1,
+	kArrow2,
+	kArrow3,
+	kArrow4,
+	kArrow5,
+	kArrow6,
+	kArrow7,
+	kPlayer0, // Actually has a "1" on his chest
+	kPlayer1,
+	kPlayer2,
+	kPlayer3
+};
+
+const int kNumMapData = kPlayer3 + 1;
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "DandyTypes.h"
+
+// The size of the map. MapT and WorldT (and GameT) take one of these as a
+// template parameter, next to the rules, so each size is compiled on its
+// own with its dimensions as constants; the classic game never pays for
+// maps bigger than the one it plays on.
+struct ClassicGeometry
+{
+	static const DWORD kWidth = 60;
+	static const DWORD kHeight = 30;
+
+	// The region around the players that monsters update in.
+	static const DWORD kViewWidth = 20;
+	static const DWORD kViewHeight = 10;
+
+	// Type of player and arrow coordinates.
+	typedef BYTE Coord;
+};
+
+// Bigger maps for stress runs and games with many players. The shipped
+// levels are 60x30, so LoadLevel tiles copies of one across the map. The
+// cells are held inline, so a world this size belongs on the heap.
+template<DWORD Width, DWORD Height>
+struct LargeGeometry
+{
+	static_assert(Width >= ClassicGeometry::kWidth && Height >= ClassicGeometry::kHeight,
+		"a level must fit on the map");
+	static_assert(Width <= 4096 && Height <= 4096, "at most 4096 cells a side");
+
+	static const DWORD kWidth = Width;
+	static const DWORD kHeight = Height;
+	static const DWORD kViewWidth = ClassicGeometry::kViewWidth;
+	static const DWORD kViewHeight = ClassicGeometry::kViewHeight;
+	typedef WORD Coord;
+};
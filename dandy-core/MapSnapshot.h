@@ -0,0 +1,116 @@
+#pragma once
+
+#include "DandyTypes.h"
+
+#include <atomic>
+#include <string.h>
+
+// A saved copy of a map's cells, one reference-counted chunk per row.
+// Map::Save only copies the rows written since the map was last saved or
+// restored and shares every other row with that snapshot, so a snapshot
+// costs its row table plus the rows that actually changed. Chunks are
+// never written once shared, and the counts are atomic, so snapshots of
+// one game can be held and restored on any number of threads.
+template<DWORD Width, DWORD Height>
+class MapSnapshot
+{
+public:
+	struct Chunk
+	{
+		std::atomic<DWORD> refs;
+		BYTE cells[Width];
+	};
+
+	MapSnapshot()
+	{
+		for(DWORD row = 0; row < Height; row++)
+		{
+			chunk[row] = NULL;
+		}
+	}
+
+	MapSnapshot(const MapSnapshot& other)
+	{
+		for(DWORD row = 0; row < Height; row++)
+		{
+			chunk[row] = AddRef(other.chunk[row]);
+		}
+	}
+
+	MapSnapshot& operator=(const MapSnapshot& other)
+	{
+		for(DWORD row = 0; row < Height; row++)
+		{
+			Share(row, other.chunk[row]);
+		}
+		return *this;
+	}
+
+	~MapSnapshot()
+	{
+		Clear();
+	}
+
+	void Clear()
+	{
+		for(DWORD row = 0; row < Height; row++)
+		{
+			Release(chunk[row]);
+			chunk[row] = NULL;
+		}
+	}
+
+	bool IsEmpty() const
+	{
+		return chunk[0] == NULL;
+	}
+
+	const Chunk* Get(DWORD row) const
+	{
+		MyBoundsCheck(row < Height);
+		return chunk[row];
+	}
+
+	// Points row at a fresh chunk holding a copy of cells.
+	void Copy(DWORD row, const BYTE* cells)
+	{
+		MyBoundsCheck(row < Height);
+		Chunk* fresh = new Chunk;
+		fresh->refs.store(1, std::memory_order_relaxed);
+		memcpy(fresh->cells, cells, Width);
+		Release(chunk[row]);
+		chunk[row] = fresh;
+	}
+
+	// Points row at another snapshot's chunk.
+	void Share(DWORD row, const Chunk* other)
+	{
+		MyBoundsCheck(row < Height);
+		if(chunk[row] != other)
+		{
+			AddRef(other);
+			Release(chunk[row]);
+			chunk[row] = other;
+		}
+	}
+
+	static const Chunk* AddRef(const Chunk* c)
+	{
+		if(c)
+		{
+			const_cast<Chunk*>(c)->refs.fetch_add(1, std::memory_order_relaxed);
+		}
+		return c;
+	}
+
+	static void Release(const Chunk* c)
+	{
+		if(c && const_cast<Chunk*>(c)->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete c;
+		}
+	}
+
+private:
+	const Chunk* chunk[Height];
+};
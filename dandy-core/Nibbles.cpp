@@ -0,0 +1,124 @@
+#include "Nibbles.h"
+#include "Cpu.h"
+
+void UnpackNibblesScalar(const BYTE* packed, BYTE* cells, DWORD numPacked)
+{
+	for(DWORD i = 0; i < numPacked; i++)
+	{
+		cells[i * 2] = (BYTE) (packed[i] & 0xf);
+		cells[i * 2 + 1] = (BYTE) (packed[i] >> 4);
+	}
+}
+
+#if DANDY_X86
+
+static void UnpackSSE2(const BYTE* packed, BYTE* cells, DWORD numPacked)
+{
+	const __m128i mask = _mm_set1_epi8(0x0f);
+	DWORD i = 0;
+	for(; i + 16 <= numPacked; i += 16)
+	{
+		__m128i b = _mm_loadu_si128((const __m128i*) (packed + i));
+		__m128i lo = _mm_and_si128(b, mask);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(b, 4), mask);
+		_mm_storeu_si128((__m128i*) (cells + i * 2), _mm_unpacklo_epi8(lo, hi));
+		_mm_storeu_si128((__m128i*) (cells + i * 2 + 16), _mm_unpackhi_epi8(lo, hi));
+	}
+	UnpackNibblesScalar(packed + i, cells + i * 2, numPacked - i);
+}
+
+DANDY_TARGET_AVX2
+static void UnpackAVX2(const BYTE* packed, BYTE* cells, DWORD numPacked)
+{
+	const __m256i mask = _mm256_set1_epi8(0x0f);
+	DWORD i = 0;
+	for(; i + 32 <= numPacked; i += 32)
+	{
+		__m256i b = _mm256_loadu_si256((const __m256i*) (packed + i));
+		__m256i lo = _mm256_and_si256(b, mask);
+		__m256i hi = _mm256_and_si256(_mm256_srli_epi16(b, 4), mask);
+		// Byte unpacks work within each 128-bit lane, so the halves come
+		// out as [0-7 | 16-23] and [8-15 | 24-31]; put them back in order.
+		__m256i a = _mm256_unpacklo_epi8(lo, hi);
+		__m256i c = _mm256_unpackhi_epi8(lo, hi);
+		_mm256_storeu_si256((__m256i*) (cells + i * 2), _mm256_permute2x128_si256(a, c, 0x20));
+		_mm256_storeu_si256((__m256i*) (cells + i * 2 + 32), _mm256_permute2x128_si256(a, c, 0x31));
+	}
+	UnpackSSE2(packed + i, cells + i * 2, numPacked - i);
+}
+
+bool UnpackNibblesSSE2(const BYTE* packed, BYTE* cells, DWORD numPacked)
+{
+	if(!Cpu::HasSSE2())
+	{
+		return false;
+	}
+	UnpackSSE2(packed, cells, numPacked);
+	return true;
+}
+
+bool UnpackNibblesAVX2(const BYTE* packed, BYTE* cells, DWORD numPacked)
+{
+	if(!Cpu::HasAVX2())
+	{
+		return false;
+	}
+	UnpackAVX2(packed, cells, numPacked);
+	return true;
+}
+
+#else
+
+bool UnpackNibblesSSE2(const BYTE*, BYTE*, DWORD)
+{
+	return false;
+}
+
+bool UnpackNibblesAVX2(const BYTE*, BYTE*, DWORD)
+{
+	return false;
+}
+
+#endif
+
+typedef void (*UnpackFunc)(const BYTE* packed, BYTE* cells, DWORD numPacked);
+
+struct UnpackKernel
+{
+	UnpackFunc func;
+	const char* name;
+};
+
+static UnpackKernel SelectKernel()
+{
+	UnpackKernel kernel = { UnpackNibblesScalar, "scalar" };
+#if DANDY_X86
+	if(Cpu::HasAVX2())
+	{
+		kernel.func = UnpackAVX2;
+		kernel.name = "avx2";
+	}
+	else if(Cpu::HasSSE2())
+	{
+		kernel.func = UnpackSSE2;
+		kernel.name = "sse2";
+	}
+#endif
+	return kernel;
+}
+
+static const UnpackKernel& Kernel()
+{
+	static const UnpackKernel kernel = SelectKernel();
+	return kernel;
+}
+
+void UnpackNibbles(const BYTE* packed, BYTE* cells, DWORD numPacked)
+{
+	Kernel().func(packed, cells, numPacked);
+}
+
+const char* UnpackNibblesKernel()
+{
+	return Kernel().name;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "DandyTypes.h"
+
+// Expands packed 4-bit cells, two per byte with the low nibble first, into
+// one byte per cell: cells[2i] = packed[i] & 0xf, cells[2i+1] = packed[i] >> 4.
+//
+// UnpackNibbles picks the widest kernel the CPU supports the first time it
+// is called (AVX2, then SSE2, then the scalar loop). The kernels are exposed
+// so benchmarks and tests can compare them.
+void UnpackNibbles(const BYTE* packed, BYTE* cells, DWORD numPacked);
+
+void UnpackNibblesScalar(const BYTE* packed, BYTE* cells, DWORD numPacked);
+
+// These return false, without writing anything, when the kernel was not
+// compiled in or the CPU lacks the instructions.
+bool UnpackNibblesSSE2(const BYTE* packed, BYTE* cells, DWORD numPacked);
+bool UnpackNibblesAVX2(const BYTE* packed, BYTE* cells, DWORD numPacked);
+
+// Name of the kernel UnpackNibbles uses on this machine.
+const char* UnpackNibblesKernel();
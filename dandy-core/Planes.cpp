@@ -0,0 +1,415 @@
+#include "Planes.h"
+#include "Cpu.h"
+
+static const FeatureRange kFeatureRanges[kNumFeaturePlanes] =
+{
+	{ kWall, kWall },
+	{ kLock, kLock },
+	{ kDown, kDown },
+	{ kKey, kKey },
+	{ kFood, kFood },
+	{ kMoney, kMoney },
+	{ kBomb, kBomb },
+	{ kGhost, kGhost },
+	{ kSmiley, kSmiley },
+	{ kBig, kBig },
+	{ kHeart, kHeart },
+	{ kGen1, kGen3 },
+	{ kArrow0, kArrow7 },
+	{ kPlayer0, kPlayer0 },
+	{ kPlayer1, kPlayer1 },
+	{ kPlayer2, kPlayer2 },
+	{ kPlayer3, kPlayer3 },
+};
+
+const FeatureRange& FeatureRangeOf(FeaturePlane plane)
+{
+	MyBoundsCheck(plane < kNumFeaturePlanes);
+	return kFeatureRanges[plane];
+}
+
+// Every kernel encodes one row of cells into all the planes, loading each
+// vector of cells once for the lot; this walks the views and rows. A
+// whole-map window written with no row padding is one long row, as the
+// cells are stored.
+template<class T, class Row>
+static void EncodeRows(const Row& row, const PlaneView* views, DWORD numViews, DWORD width, DWORD height, T* out,
+	const PlaneStrides& strides)
+{
+	MyAssert(width <= Map::Width && height <= Map::Height && strides.row >= width);
+	for(DWORD v = 0; v < numViews; v++)
+	{
+		MyAssert(views[v].left + width <= Map::Width && views[v].top + height <= Map::Height);
+	}
+	if(width == Map::Width && strides.row == width)
+	{
+		width *= height;
+		height = 1;
+	}
+	for(DWORD v = 0; v < numViews; v++)
+	{
+		const BYTE* cells = views[v].cells + views[v].top * Map::Width + views[v].left;
+		T* o = out + v * strides.view;
+		for(DWORD y = 0; y < height; y++)
+		{
+			row(cells + y * Map::Width, width, o + y * strides.row, strides.plane);
+		}
+	}
+}
+
+template<class T>
+struct ScalarRow
+{
+	void operator()(const BYTE* cells, DWORD width, T* out, size_t planeStride) const
+	{
+		for(DWORD p = 0; p < kNumFeaturePlanes; p++, out += planeStride)
+		{
+			BYTE first = kFeatureRanges[p].first;
+			BYTE span = (BYTE) (kFeatureRanges[p].last - first);
+			for(DWORD x = 0; x < width; x++)
+			{
+				out[x] = (BYTE) (cells[x] - first) <= span ? (T) 1 : (T) 0;
+			}
+		}
+	}
+};
+
+void EncodePlanesScalar(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, BYTE* out, const PlaneStrides& strides)
+{
+	EncodeRows(ScalarRow<BYTE>(), views, numViews, width, height, out, strides);
+}
+
+void EncodePlanesScalar(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, float* out, const PlaneStrides& strides)
+{
+	EncodeRows(ScalarRow<float>(), views, numViews, width, height, out, strides);
+}
+
+#if DANDY_X86
+
+// A cell is in a plane when (cell - first) <= (last - first) as unsigned
+// bytes, and SSE2 has an unsigned byte min but no unsigned compare, so the
+// test is min(d, span) == d. Rows that are not a whole number of vectors
+// finish with one vector ending at the last cell, rewriting a few cells
+// with the same values; rows narrower than a vector fall back.
+struct SSE2Row
+{
+	SSE2Row()
+	{
+		for(DWORD p = 0; p < kNumFeaturePlanes; p++)
+		{
+			first[p] = _mm_set1_epi8((char) kFeatureRanges[p].first);
+			span[p] = _mm_set1_epi8((char) (kFeatureRanges[p].last - kFeatureRanges[p].first));
+		}
+	}
+
+	__m128i Mask(__m128i c, DWORD p) const
+	{
+		__m128i d = _mm_sub_epi8(c, first[p]);
+		return _mm_cmpeq_epi8(_mm_min_epu8(d, span[p]), d);
+	}
+
+	void operator()(const BYTE* cells, DWORD width, BYTE* out, size_t planeStride) const
+	{
+		if(width < 16)
+		{
+			ScalarRow<BYTE>()(cells, width, out, planeStride);
+			return;
+		}
+		const __m128i one = _mm_set1_epi8(1);
+		for(DWORD x = 0; x < width; x += 16)
+		{
+			x = x + 16 > width ? width - 16 : x;
+			__m128i c = _mm_loadu_si128((const __m128i*) (cells + x));
+			BYTE* o = out + x;
+			for(DWORD p = 0; p < kNumFeaturePlanes; p++, o += planeStride)
+			{
+				_mm_storeu_si128((__m128i*) o, _mm_and_si128(Mask(c, p), one));
+			}
+		}
+	}
+
+	// The byte mask widened to four vectors of 32-bit lanes and ANDed with
+	// the bits of 1.0f. Four times the stores make the overlap of the last
+	// vector dear, so it only stores the quads the one before it did not.
+	static void StoreFloats(float* o, __m128i m, DWORD skip)
+	{
+		const __m128i one = _mm_set1_epi32(0x3f800000);
+		__m128i lo = _mm_unpacklo_epi8(m, m);
+		__m128i hi = _mm_unpackhi_epi8(m, m);
+		switch(skip)
+		{
+		case 0:
+			_mm_storeu_si128((__m128i*) o, _mm_and_si128(_mm_unpacklo_epi16(lo, lo), one));
+			// Fall through
+		case 1:
+			_mm_storeu_si128((__m128i*) (o + 4), _mm_and_si128(_mm_unpackhi_epi16(lo, lo), one));
+			// Fall through
+		case 2:
+			_mm_storeu_si128((__m128i*) (o + 8), _mm_and_si128(_mm_unpacklo_epi16(hi, hi), one));
+			// Fall through
+		default:
+			_mm_storeu_si128((__m128i*) (o + 12), _mm_and_si128(_mm_unpackhi_epi16(hi, hi), one));
+		}
+	}
+
+	void operator()(const BYTE* cells, DWORD width, float* out, size_t planeStride) const
+	{
+		if(width < 16)
+		{
+			ScalarRow<float>()(cells, width, out, planeStride);
+			return;
+		}
+		DWORD x = 0;
+		for(; x + 16 <= width; x += 16)
+		{
+			__m128i c = _mm_loadu_si128((const __m128i*) (cells + x));
+			float* o = out + x;
+			for(DWORD p = 0; p < kNumFeaturePlanes; p++, o += planeStride)
+			{
+				StoreFloats(o, Mask(c, p), 0);
+			}
+		}
+		if(x < width)
+		{
+			DWORD skip = (x + 16 - width) / 4;
+			x = width - 16;
+			__m128i c = _mm_loadu_si128((const __m128i*) (cells + x));
+			float* o = out + x;
+			for(DWORD p = 0; p < kNumFeaturePlanes; p++, o += planeStride)
+			{
+				StoreFloats(o, Mask(c, p), skip);
+			}
+		}
+	}
+
+	__m128i first[kNumFeaturePlanes];
+	__m128i span[kNumFeaturePlanes];
+};
+
+// The same with 32 cells at a time; rows narrower than that (the 20-wide
+// view) go to SSE2.
+struct AVX2Row
+{
+	DANDY_TARGET_AVX2
+	AVX2Row()
+	{
+		for(DWORD p = 0; p < kNumFeaturePlanes; p++)
+		{
+			first[p] = _mm256_set1_epi8((char) kFeatureRanges[p].first);
+			span[p] = _mm256_set1_epi8((char) (kFeatureRanges[p].last - kFeatureRanges[p].first));
+		}
+	}
+
+	DANDY_TARGET_AVX2
+	__m256i Mask(__m256i c, DWORD p) const
+	{
+		__m256i d = _mm256_sub_epi8(c, first[p]);
+		return _mm256_cmpeq_epi8(_mm256_min_epu8(d, span[p]), d);
+	}
+
+	DANDY_TARGET_AVX2
+	void operator()(const BYTE* cells, DWORD width, BYTE* out, size_t planeStride) const
+	{
+		if(width < 32)
+		{
+			narrow(cells, width, out, planeStride);
+			return;
+		}
+		const __m256i one = _mm256_set1_epi8(1);
+		for(DWORD x = 0; x < width; x += 32)
+		{
+			x = x + 32 > width ? width - 32 : x;
+			__m256i c = _mm256_loadu_si256((const __m256i*) (cells + x));
+			BYTE* o = out + x;
+			for(DWORD p = 0; p < kNumFeaturePlanes; p++, o += planeStride)
+			{
+				_mm256_storeu_si256((__m256i*) o, _mm256_and_si256(Mask(c, p), one));
+			}
+		}
+	}
+
+	// Sign-extending eight mask bytes at a time keeps the floats in order,
+	// unlike the in-lane unpacks.
+	DANDY_TARGET_AVX2
+	static void StoreFloats(float* o, __m256i m, DWORD skip)
+	{
+		const __m256i one = _mm256_set1_epi32(0x3f800000);
+		__m128i lo = _mm256_castsi256_si128(m);
+		__m128i hi = _mm256_extracti128_si256(m, 1);
+		switch(skip)
+		{
+		case 0:
+			_mm256_storeu_si256((__m256i*) o, _mm256_and_si256(_mm256_cvtepi8_epi32(lo), one));
+			// Fall through
+		case 1:
+			_mm256_storeu_si256((__m256i*) (o + 8), _mm256_and_si256(_mm256_cvtepi8_epi32(_mm_srli_si128(lo, 8)), one));
+			// Fall through
+		case 2:
+			_mm256_storeu_si256((__m256i*) (o + 16), _mm256_and_si256(_mm256_cvtepi8_epi32(hi), one));
+			// Fall through
+		default:
+			_mm256_storeu_si256((__m256i*) (o + 24), _mm256_and_si256(_mm256_cvtepi8_epi32(_mm_srli_si128(hi, 8)), one));
+		}
+	}
+
+	DANDY_TARGET_AVX2
+	void operator()(const BYTE* cells, DWORD width, float* out, size_t planeStride) const
+	{
+		if(width < 32)
+		{
+			narrow(cells, width, out, planeStride);
+			return;
+		}
+		DWORD x = 0;
+		for(; x + 32 <= width; x += 32)
+		{
+			__m256i c = _mm256_loadu_si256((const __m256i*) (cells + x));
+			float* o = out + x;
+			for(DWORD p = 0; p < kNumFeaturePlanes; p++, o += planeStride)
+			{
+				StoreFloats(o, Mask(c, p), 0);
+			}
+		}
+		if(x < width)
+		{
+			DWORD skip = (x + 32 - width) / 8;
+			x = width - 32;
+			__m256i c = _mm256_loadu_si256((const __m256i*) (cells + x));
+			float* o = out + x;
+			for(DWORD p = 0; p < kNumFeaturePlanes; p++, o += planeStride)
+			{
+				StoreFloats(o, Mask(c, p), skip);
+			}
+		}
+	}
+
+	SSE2Row narrow;
+	__m256i first[kNumFeaturePlanes];
+	__m256i span[kNumFeaturePlanes];
+};
+
+template<class T>
+static void EncodeSSE2(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, T* out, const PlaneStrides& strides)
+{
+	EncodeRows(SSE2Row(), views, numViews, width, height, out, strides);
+}
+
+template<class T>
+DANDY_TARGET_AVX2
+static void EncodeAVX2(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, T* out, const PlaneStrides& strides)
+{
+	EncodeRows(AVX2Row(), views, numViews, width, height, out, strides);
+}
+
+bool EncodePlanesSSE2(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, BYTE* out, const PlaneStrides& strides)
+{
+	if(!Cpu::HasSSE2())
+	{
+		return false;
+	}
+	EncodeSSE2(views, numViews, width, height, out, strides);
+	return true;
+}
+
+bool EncodePlanesSSE2(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, float* out, const PlaneStrides& strides)
+{
+	if(!Cpu::HasSSE2())
+	{
+		return false;
+	}
+	EncodeSSE2(views, numViews, width, height, out, strides);
+	return true;
+}
+
+bool EncodePlanesAVX2(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, BYTE* out, const PlaneStrides& strides)
+{
+	if(!Cpu::HasAVX2())
+	{
+		return false;
+	}
+	EncodeAVX2(views, numViews, width, height, out, strides);
+	return true;
+}
+
+bool EncodePlanesAVX2(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, float* out, const PlaneStrides& strides)
+{
+	if(!Cpu::HasAVX2())
+	{
+		return false;
+	}
+	EncodeAVX2(views, numViews, width, height, out, strides);
+	return true;
+}
+
+#else
+
+bool EncodePlanesSSE2(const PlaneView*, DWORD, DWORD, DWORD, BYTE*, const PlaneStrides&)
+{
+	return false;
+}
+
+bool EncodePlanesSSE2(const PlaneView*, DWORD, DWORD, DWORD, float*, const PlaneStrides&)
+{
+	return false;
+}
+
+bool EncodePlanesAVX2(const PlaneView*, DWORD, DWORD, DWORD, BYTE*, const PlaneStrides&)
+{
+	return false;
+}
+
+bool EncodePlanesAVX2(const PlaneView*, DWORD, DWORD, DWORD, float*, const PlaneStrides&)
+{
+	return false;
+}
+
+#endif
+
+template<class T>
+struct EncodeKernel
+{
+	typedef void (*Func)(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, T* out, const PlaneStrides& strides);
+	Func func;
+	const char* name;
+};
+
+template<class T>
+static EncodeKernel<T> SelectKernel()
+{
+	EncodeKernel<T> kernel = { EncodePlanesScalar, "scalar" };
+#if DANDY_X86
+	if(Cpu::HasAVX2())
+	{
+		kernel.func = EncodeAVX2<T>;
+		kernel.name = "avx2";
+	}
+	else if(Cpu::HasSSE2())
+	{
+		kernel.func = EncodeSSE2<T>;
+		kernel.name = "sse2";
+	}
+#endif
+	return kernel;
+}
+
+template<class T>
+static const EncodeKernel<T>& Kernel()
+{
+	static const EncodeKernel<T> kernel = SelectKernel<T>();
+	return kernel;
+}
+
+void EncodePlanes(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, BYTE* out, const PlaneStrides& strides)
+{
+	Kernel<BYTE>().func(views, numViews, width, height, out, strides);
+}
+
+void EncodePlanes(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, float* out, const PlaneStrides& strides)
+{
+	Kernel<float>().func(views, numViews, width, height, out, strides);
+}
+
+const char* EncodePlanesKernel()
+{
+	return Kernel<BYTE>().name;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "DandyTypes.h"
+#include "Map.h"
+
+#include <stddef.h>
+
+// One-hot feature planes of a map for learning agents: plane p of a cell is
+// 1 if the cell's MapData is one of the kinds listed for p, else 0. Monster
+// and player kinds get a plane each; the three generators share one, as do
+// the eight arrow directions. kSpace and kUp are in no plane.
+enum FeaturePlane
+{
+	kFeatureWall,
+	kFeatureLock,
+	kFeatureExit,		// kDown
+	kFeatureKey,
+	kFeatureFood,
+	kFeatureMoney,
+	kFeatureBomb,
+	kFeatureGhost,
+	kFeatureSmiley,
+	kFeatureBig,
+	kFeatureHeart,
+	kFeatureGenerator,	// kGen1 .. kGen3
+	kFeatureArrow,		// kArrow0 .. kArrow7
+	kFeaturePlayer0,
+	kFeaturePlayer1,
+	kFeaturePlayer2,
+	kFeaturePlayer3,
+	kNumFeaturePlanes
+};
+
+// The MapData range, first to last, that sets each plane.
+struct FeatureRange
+{
+	BYTE first;
+	BYTE last;
+};
+
+const FeatureRange& FeatureRangeOf(FeaturePlane plane);
+
+// A width x height window of one map, from (left, top). The window must lie
+// inside the map.
+struct PlaneView
+{
+	const BYTE* cells;	// Map::Cell
+	DWORD left;
+	DWORD top;
+};
+
+// Where each output element goes, counted in elements (bytes or floats):
+// view v, plane p, row y, column x is out[v * view + p * plane + y * row + x].
+// Rows are written whole, so row must be at least the window width.
+struct PlaneStrides
+{
+	size_t view;
+	size_t plane;
+	size_t row;
+};
+
+struct Planes
+{
+	// The whole map.
+	static PlaneView Full(const BYTE* cells)
+	{
+		PlaneView v = { cells, 0, 0 };
+		return v;
+	}
+
+	// The Map::ViewWidth x Map::ViewHeight window the screen would show
+	// around (x, y): centred on it, pushed in from the edges of the map.
+	static PlaneView Around(const BYTE* cells, DWORD x, DWORD y)
+	{
+		PlaneView v = { cells, Origin(x, Map::Width, Map::ViewWidth), Origin(y, Map::Height, Map::ViewHeight) };
+		return v;
+	}
+
+	// Packed planes with no padding, views back to back.
+	static PlaneStrides Dense(DWORD width, DWORD height)
+	{
+		PlaneStrides s = { (size_t) kNumFeaturePlanes * width * height, (size_t) width * height, width };
+		return s;
+	}
+
+	static DWORD Origin(DWORD x, DWORD size, DWORD view)
+	{
+		return x < view / 2 ? 0 : x - view / 2 > size - view ? size - view : x - view / 2;
+	}
+};
+
+// Writes the kNumFeaturePlanes planes of every view in one call, as bytes
+// (0 or 1) or floats (0.0f or 1.0f).
+//
+// EncodePlanes picks the widest kernel the CPU supports the first time it
+// is called (AVX2, then SSE2, then the scalar loop). The kernels are exposed
+// so benchmarks and tests can compare them.
+void EncodePlanes(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, BYTE* out, const PlaneStrides& strides);
+void EncodePlanes(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, float* out, const PlaneStrides& strides);
+
+void EncodePlanesScalar(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, BYTE* out, const PlaneStrides& strides);
+void EncodePlanesScalar(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, float* out, const PlaneStrides& strides);
+
+// These return false, without writing anything, when the kernel was not
+// compiled in or the CPU lacks the instructions.
+bool EncodePlanesSSE2(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, BYTE* out, const PlaneStrides& strides);
+bool EncodePlanesSSE2(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, float* out, const PlaneStrides& strides);
+bool EncodePlanesAVX2(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, BYTE* out, const PlaneStrides& strides);
+bool EncodePlanesAVX2(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, float* out, const PlaneStrides& strides);
+
+// Name of the kernel EncodePlanes uses on this machine.
+const char* EncodePlanesKernel();
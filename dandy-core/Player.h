@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Map.h"
+
+// Players and arrows hold their coordinates as Coord, a map geometry's
+// coordinate type (see MapGeometry.h).
+template<class Coord>
+class ArrowT
+{
+public:
+	ArrowT()
+	{
+		alive = false;
+		x = 0;
+		y = 0;
+		dir = kDirNone;
+	}
+
+	static bool CanGo(MapData d)
+	{
+		return HasTrait(d, kTileArrowPath);
+	}
+
+	static bool CanHit(MapData d)
+	{
+		return HasTrait(d, kTileArrowTarget);
+	}
+
+	bool alive;
+	Coord x;
+	Coord y;
+	Direction dir;
+};
+
+typedef ArrowT<BYTE> Arrow;
+
+enum PlayerState
+{
+	kNormal,
+	kInWarp,
+	kNotInGame	// A free slot, waiting for a pad (Xbox 360 rules)
+};
+
+template<class Coord>
+class PlayerT
+{
+public:
+	PlayerT()
+	{
+		Init();
+	}
+
+	void Init(BYTE healthMax = kHealthMax)
+	{
+		x = 0;
+		y = 0;
+		state = kNormal;
+		health = healthMax;
+		food = 0;
+		bombs = 0;
+		keys = 0;
+		score = 0;
+		dir = kDirNone;
+		lastMoveTick = 0;
+		arrow = ArrowT<Coord>();
+	}
+
+	bool IsInGame() const
+	{
+		return state != kNotInGame;
+	}
+
+	bool IsAlive() const
+	{
+		return health > 0 && state != kNotInGame;
+	}
+
+	bool IsVisible() const
+	{
+		return health > 0 && state == kNormal;
+	}
+
+	void EatFood(BYTE healthMax = kHealthMax)
+	{
+		if(food > 0 && health < healthMax)
+		{
+			--food;
+			health = healthMax;
+		}
+	}
+
+	static const int kHealthMax = 9; // ClassicRules; WorldT passes its rules' value
+	Coord x;
+	Coord y;
+	BYTE health;
+	BYTE food;
+	BYTE keys;
+	BYTE bombs;
+	DWORD score;
+	PlayerState state;
+	DWORD lastMoveTick;
+	Direction dir;
+	ArrowT<Coord> arrow;
+};
+
+typedef PlayerT<BYTE> Player;
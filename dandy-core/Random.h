@@ -0,0 +1,55 @@
+#pragma once
+
+#include "DandyTypes.h"
+
+// Small seedable PRNG (PCG32). Every World owns one, so a game's random
+// stream depends only on its seed, never on other worlds or on rand().
+class Random
+{
+public:
+	Random()
+	{
+		Seed(0);
+	}
+
+	explicit Random(uint64_t seed)
+	{
+		Seed(seed);
+	}
+
+	void Seed(uint64_t seed)
+	{
+		state = 0;
+		Next();
+		state += seed;
+		Next();
+	}
+
+	DWORD Next()
+	{
+		uint64_t old = state;
+		state = old * 6364136223846793005ULL + kIncrement;
+		DWORD xorShifted = (DWORD) (((old >> 18) ^ old) >> 27);
+		DWORD rot = (DWORD) (old >> 59);
+		return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+	}
+
+	DWORD Get(DWORD range)
+	{
+		return Next() % range;
+	}
+
+	// SplitMix64 finalizer: turns related seeds (a base plus an index)
+	// into unrelated ones.
+	static uint64_t Mix(uint64_t z)
+	{
+		z += 0x9e3779b97f4a7c15ULL;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t state;
+
+	static const uint64_t kIncrement = 1442695040888963407ULL;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "World.h"
+
+#include <type_traits>
+
+// Ray sensors for lightweight policies: from each player, what lies along
+// each of the 8 directions (kDirOffsets order) and how far away. A ray
+// stops at the first cell that is not kSpace, so walls hide what is behind
+// them, and so do monsters, pickups and other players.
+//
+// Distances are the map's RayTables distance type: bytes on maps under 256
+// cells a side (RaySensor, for the classic map), words on larger ones.
+template<class Dist>
+struct RaySensorT
+{
+	Dist distance[8];	// Cells to what the ray hit; 0 if it hit nothing
+	BYTE hit[8];		// BitPlane of what it hit (kPlaneWall, kPlaneMonster...), kNoPlane if nothing
+};
+
+typedef RaySensorT<BYTE> RaySensor;
+
+struct RaySensors
+{
+	// Reads world.PlayerCount sensors into out, one per player slot. Players
+	// not on the map (dead, in a warp, free slots) read as hitting nothing.
+	// With the map's ray tables enabled (Map::EnableRays) a ray is one table
+	// lookup; without them it steps the grid.
+	template<class WorldType, class Dist>
+	static void Sense(const WorldType& world, RaySensorT<Dist>* out)
+	{
+		typedef typename WorldType::Map Map;
+		static_assert(std::is_same<Dist, typename Map::CellRays::Dist>::value,
+			"sensors must hold the map's ray distances");
+		const Map& map = world.map;
+		for(DWORD i = 0; i < WorldType::PlayerCount; i++)
+		{
+			RaySensorT<Dist>& s = out[i];
+			const typename WorldType::Player& p = world.player[i];
+			if(!p.IsVisible())
+			{
+				memset(s.distance, 0, sizeof(s.distance));
+				memset(s.hit, kNoPlane, sizeof(s.hit));
+				continue;
+			}
+			DWORD index = Map::Index(p.x, p.y);
+			for(DWORD dir = 0; dir < 8; dir++)
+			{
+				Dist d = map.raysEnabled ? map.rays.Distance(index, dir) : Cast(map, p.x, p.y, dir);
+				s.distance[dir] = d;
+				s.hit[dir] = d ? (BYTE) Map::CellBitboards::PlaneOf(map.Cell[index + d * Map::Step(dir)]) : (BYTE) kNoPlane;
+			}
+		}
+	}
+
+	// Sensors for a batch of worlds, PlayerCount per world, back to back.
+	template<class WorldType, class Dist>
+	static void Sense(const WorldType* const* worlds, DWORD numWorlds, RaySensorT<Dist>* out)
+	{
+		for(DWORD w = 0; w < numWorlds; w++)
+		{
+			Sense(*worlds[w], out + w * WorldType::PlayerCount);
+		}
+	}
+
+	// The distance a ray from (x, y) travels in direction dir by stepping
+	// cell by cell, as the tables hold it.
+	template<class MapType>
+	static typename MapType::CellRays::Dist Cast(const MapType& map, DWORD x, DWORD y, DWORD dir)
+	{
+		typedef typename MapType::CellRays::Dist Dist;
+		int dx = kDirOffsets[dir][0];
+		int dy = kDirOffsets[dir][1];
+		x += dx;
+		y += dy;
+		for(DWORD k = 1; x < MapType::Width && y < MapType::Height; k++, x += dx, y += dy)
+		{
+			if(map.Get(x, y) != kSpace)
+			{
+				return (Dist) k;
+			}
+		}
+		return 0;
+	}
+};
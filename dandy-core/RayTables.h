@@ -0,0 +1,142 @@
+#pragma once
+
+#include "DandyTypes.h"
+#include "MapData.h"
+
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+// For every cell and each of the 8 directions (kDirOffsets order), the
+// number of cells to the first one along that direction that is not
+// kSpace: 1 for a neighbour, 0 if the ray leaves the map first. Whatever
+// is there (wall, monster, pickup, exit...) is read from the map, so only
+// a cell turning empty or occupied changes the tables. The change is
+// walked back along each direction to the next occupied cell, which
+// shadows everything behind it; in rooms and corridors that is a few
+// cells. Distances are stored as bytes when the map is small enough.
+template<DWORD Width, DWORD Height>
+class RayTables
+{
+public:
+	static const DWORD kNumCells = Width * Height;
+	typedef typename std::conditional<(Width < 256 && Height < 256), BYTE, WORD>::type Dist;
+
+	// Rays with an up or down component are filled a row at a time from
+	// the row they point into, which the compiler can vectorize; left and
+	// right are one sweep along each row.
+	void Rebuild(const BYTE* cells)
+	{
+		distance.resize(kNumCells * 8);
+		for(DWORD dir = 0; dir < 8; dir++)
+		{
+			int dx = kDirOffsets[dir][0];
+			int dy = kDirOffsets[dir][1];
+			Dist* d = &distance[dir * kNumCells];
+			if(dy == 0)
+			{
+				for(DWORD y = 0; y < Height; y++)
+				{
+					Dist* row = d + y * Width;
+					const BYTE* c = cells + y * Width;
+					DWORD x = dx > 0 ? Width - 1 : 0;
+					row[x] = 0;
+					for(DWORD i = 1; i < Width; i++)
+					{
+						DWORD next = x;
+						x -= dx;
+						row[x] = Next(c[next], row[next]);
+					}
+				}
+				continue;
+			}
+			DWORD first = dx < 0 ? 1 : 0;
+			DWORD last = dx > 0 ? Width - 1 : Width;
+			for(DWORD i = 0; i < Height; i++)
+			{
+				DWORD y = dy > 0 ? Height - 1 - i : i;
+				Dist* row = d + y * Width;
+				DWORD ny = y + dy;
+				if(ny >= Height)
+				{
+					memset(row, 0, Width * sizeof(Dist));
+					continue;
+				}
+				const BYTE* c = cells + ny * Width;
+				const Dist* n = d + ny * Width;
+				row[0] = 0;
+				row[Width - 1] = 0;
+				for(DWORD x = first; x < last; x++)
+				{
+					row[x] = Next(c[x + dx], n[x + dx]);
+				}
+			}
+		}
+	}
+
+	void Clear()
+	{
+		distance.clear();
+	}
+
+	// cells already holds after. Only cells inside the border change (the
+	// border is all wall), and a walk back from one always ends at the
+	// border if not before, so it steps by index without bounds tests.
+	// Writes made out of order (SetDeferred, then ApplyChanges) come out
+	// the same, as each walk stops at the cells as they finally are.
+	void Update(const BYTE* cells, DWORD index, BYTE before, BYTE after)
+	{
+		if((before == kSpace) == (after == kSpace))
+		{
+			return;
+		}
+		MyBoundsCheck(index % Width - 1 < Width - 2 && index / Width - 1 < Height - 2);
+		for(DWORD dir = 0; dir < 8; dir++)
+		{
+			int step = kDirOffsets[dir][0] + kDirOffsets[dir][1] * (int) Width;
+			Dist* d = &distance[dir * kNumCells];
+			// Cells behind index now see it, or whatever it used to hide.
+			DWORD j = index - step;
+			if(after != kSpace)
+			{
+				for(Dist k = 1; ; k++, j -= step)
+				{
+					d[j] = k;
+					if(cells[j] != kSpace)
+					{
+						break;
+					}
+				}
+			}
+			else
+			{
+				Dist beyond = d[index];
+				for(Dist k = beyond ? (Dist) (beyond + 1) : 0; ; k = k ? (Dist) (k + 1) : 0, j -= step)
+				{
+					d[j] = k;
+					if(cells[j] != kSpace)
+					{
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	Dist Distance(DWORD index, DWORD dir) const
+	{
+		MyBoundsCheck(index < kNumCells && dir < 8 && !distance.empty());
+		return distance[dir * kNumCells + index];
+	}
+
+private:
+	// The distance from a cell whose neighbour along the ray is next, at
+	// nextDistance from its own first hit.
+	static Dist Next(BYTE next, Dist nextDistance)
+	{
+		return next != kSpace ? 1 : nextDistance ? (Dist) (nextDistance + 1) : 0;
+	}
+
+	// One plane of kNumCells per direction.
+	std::vector<Dist> distance;
+};
@@ -0,0 +1,255 @@
+#include "Replay.h"
+#include "ByteOrder.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char kMagic[4] = { 'D', 'R', 'P', 'L' };
+
+static void Write64(BYTE* p, uint64_t v)
+{
+	Write32(p, (DWORD) v);
+	Write32(p + 4, (DWORD) (v >> 32));
+}
+
+static uint64_t Read64(const BYTE* p)
+{
+	return Read32(p) | ((uint64_t) Read32(p + 4) << 32);
+}
+
+static void WriteVarint(std::vector<BYTE>& out, DWORD v)
+{
+	while(v >= 0x80)
+	{
+		out.push_back((BYTE) (v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((BYTE) v);
+}
+
+static bool ReadVarint(const BYTE*& p, const BYTE* end, DWORD& v)
+{
+	v = 0;
+	for(DWORD shift = 0; shift < 35; shift += 7)
+	{
+		if(p == end)
+		{
+			return false;
+		}
+		BYTE b = *p++;
+		v |= (DWORD) (b & 0x7f) << shift;
+		if(!(b & 0x80))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// A keyframe's state XORed with the one before it, as (zero run, literal
+// run, literal bytes) triples. The last triple may have no literals.
+static void EncodeDelta(std::vector<BYTE>& out, const BYTE* state, const BYTE* previous, DWORD size)
+{
+	DWORD i = 0;
+	while(i < size)
+	{
+		DWORD zeros = i;
+		while(i < size && state[i] == previous[i])
+		{
+			++i;
+		}
+		DWORD literals = i;
+		// Stop a literal run only at a gap worth a new triple.
+		DWORD gap = 0;
+		while(i < size && gap < 3)
+		{
+			gap = state[i] == previous[i] ? gap + 1 : 0;
+			++i;
+		}
+		if(gap)
+		{
+			i -= gap;
+		}
+		WriteVarint(out, literals - zeros);
+		WriteVarint(out, i - literals);
+		for(DWORD j = literals; j < i; j++)
+		{
+			out.push_back(state[j] ^ previous[j]);
+		}
+	}
+}
+
+static bool DecodeDelta(const BYTE* p, const BYTE* end, BYTE* state, const BYTE* previous, DWORD size)
+{
+	DWORD i = 0;
+	while(p != end)
+	{
+		DWORD zeros, literals;
+		if(!ReadVarint(p, end, zeros) || !ReadVarint(p, end, literals)
+			|| zeros > size - i || literals > size - i - zeros || literals > (DWORD) (end - p))
+		{
+			return false;
+		}
+		memcpy(state + i, previous + i, zeros);
+		i += zeros;
+		for(DWORD j = 0; j < literals; j++, i++)
+		{
+			state[i] = previous[i] ^ *p++;
+		}
+	}
+	return i == size;
+}
+
+void Replay::Encode(std::vector<BYTE>& out) const
+{
+	out.assign(kHeaderSize, 0);
+	BYTE* h = &out[0];
+	memcpy(h, kMagic, 4);
+	Write16(h + 4, kVersion);
+	h[6] = rules;
+	h[7] = pathing;
+	h[8] = (BYTE) kNumPads;
+	Write64(h + 12, seed);
+	Write32(h + 20, level);
+	Write32(h + 24, ticks);
+	Write64(h + 28, checksum);
+	for(DWORD s = 0; s < kNumStreams; s++)
+	{
+		WriteVarint(out, (DWORD) streams[s].size());
+		for(size_t r = 0; r < streams[s].size(); r++)
+		{
+			out.push_back(streams[s][r].value);
+			WriteVarint(out, streams[s][r].length);
+		}
+	}
+	WriteVarint(out, kStateSize);
+	WriteVarint(out, keyframeInterval);
+	WriteVarint(out, (DWORD) keyframes.size());
+	std::vector<BYTE> zero(kStateSize, 0);
+	std::vector<BYTE> delta;
+	for(size_t k = 0; k < keyframes.size(); k++)
+	{
+		delta.clear();
+		EncodeDelta(delta, keyframes[k].data(), k ? keyframes[k - 1].data() : zero.data(), kStateSize);
+		WriteVarint(out, keyframeTicks[k]);
+		WriteVarint(out, (DWORD) delta.size());
+		out.insert(out.end(), delta.begin(), delta.end());
+	}
+}
+
+bool Replay::Decode(const BYTE* data, size_t size)
+{
+	if(size < kHeaderSize || memcmp(data, kMagic, 4) || data[8] != kNumPads)
+	{
+		return false;
+	}
+	WORD version = Read16(data + 4);
+	if(version < 1 || version > kVersion)
+	{
+		return false;
+	}
+	Start(data[6], Read64(data + 12), Read32(data + 20), (MonsterPathing) data[7]);
+	DWORD expected = Read32(data + 24);
+	checksum = Read64(data + 28);
+	const BYTE* p = data + kHeaderSize;
+	const BYTE* end = data + size;
+	for(DWORD s = 0; s < kNumStreams; s++)
+	{
+		DWORD count;
+		if(!ReadVarint(p, end, count) || count > (DWORD) (end - p))
+		{
+			return false;
+		}
+		streams[s].resize(count);
+		DWORD total = 0;
+		for(DWORD r = 0; r < count; r++)
+		{
+			if(p == end)
+			{
+				return false;
+			}
+			streams[s][r].value = *p++;
+			streams[s][r].start = total;
+			if(!ReadVarint(p, end, streams[s][r].length) || streams[s][r].length == 0
+				|| streams[s][r].length > expected - total)
+			{
+				return false;
+			}
+			total += streams[s][r].length;
+		}
+		// Every stream covers every tick.
+		if(total != expected)
+		{
+			return false;
+		}
+	}
+	ticks = expected;
+	if(version < 2)
+	{
+		return p == end;
+	}
+
+	// A keyframe is decoded against the one before, so they are all decoded
+	// here and a seek restores just one.
+	DWORD stateSize, count;
+	if(!ReadVarint(p, end, stateSize) || stateSize != kStateSize
+		|| !ReadVarint(p, end, keyframeInterval) || !ReadVarint(p, end, count)
+		|| count > (DWORD) (end - p) || (count && keyframeInterval == 0))
+	{
+		return false;
+	}
+	std::vector<BYTE> zero(kStateSize, 0);
+	keyframeTicks.resize(count);
+	keyframes.resize(count);
+	for(DWORD k = 0; k < count; k++)
+	{
+		DWORD deltaSize;
+		if(!ReadVarint(p, end, keyframeTicks[k]) || keyframeTicks[k] >= ticks
+			|| keyframeTicks[k] % keyframeInterval != 0 || (k && keyframeTicks[k] <= keyframeTicks[k - 1])
+			|| !ReadVarint(p, end, deltaSize) || deltaSize > (DWORD) (end - p))
+		{
+			return false;
+		}
+		keyframes[k].resize(kStateSize);
+		// Seek restores a keyframe as it is, so it must hold a world ReadState
+		// can take.
+		if(!DecodeDelta(p, p + deltaSize, keyframes[k].data(), k ? keyframes[k - 1].data() : zero.data(), kStateSize)
+			|| !World::IsValidState(keyframes[k].data()))
+		{
+			return false;
+		}
+		p += deltaSize;
+	}
+	return p == end;
+}
+
+bool Replay::Write(const char* path) const
+{
+	std::vector<BYTE> data;
+	Encode(data);
+	FILE* f = fopen(path, "wb");
+	if(!f)
+	{
+		return false;
+	}
+	bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+	return fclose(f) == 0 && ok;
+}
+
+bool Replay::Read(const char* path)
+{
+	FILE* f = fopen(path, "rb");
+	if(!f)
+	{
+		return false;
+	}
+	std::vector<BYTE> data;
+	BYTE buffer[65536];
+	size_t n;
+	while((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + n);
+	}
+	fclose(f);
+	return Decode(data.data(), data.size());
+}
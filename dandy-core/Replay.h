@@ -0,0 +1,308 @@
+#pragma once
+
+#include "Game.h"
+
+#include <algorithm>
+#include <vector>
+
+// A recorded game: the seed, pathing and starting level, then every tick's
+// pad buttons for each player and the mask of connected pads. Replaying it
+// through a fresh Game reproduces the game bit for bit, at whatever speed
+// the CPU allows.
+//
+// A recording may also hold keyframes: the whole World (WriteState) as it
+// was at the start of every keyframeInterval-th tick. Seek restores the
+// last keyframe at or before the target and plays from there, so seeking
+// costs one restore and fewer than keyframeInterval ticks.
+//
+// On disk, all integers little-endian, counts and lengths as LEB128:
+//
+//   header   40 bytes   "DRPL", version, rules (kId), pathing, player count,
+//                       seed, starting level, tick count, and the
+//                       World::Checksum after the last tick (0 if unknown)
+//   streams  one per player and one for the connected mask, each a run
+//            count and then (value, length) for every run of ticks the
+//            value was held
+//   keys     (version 2) state size, keyframe interval and count, then per
+//            keyframe its tick, and its state XORed with the previous
+//            keyframe's as (zero run, literal run, literal bytes) triples,
+//            preceded by their size
+//
+// Pads are held for many ticks at a time, so a stream usually costs a few
+// bits per tick, and most of the map is the same from one keyframe to the
+// next, so a keyframe usually costs a few hundred bytes.
+class Replay
+{
+public:
+	struct Run
+	{
+		BYTE value;
+		DWORD length;
+		DWORD start;	// First tick of the run
+	};
+
+	static const DWORD kNumPads = World::PlayerCount;
+	static const DWORD kConnectedStream = kNumPads;
+	static const DWORD kNumStreams = kNumPads + 1;
+	static const DWORD kHeaderSize = 40;
+	static const WORD kVersion = 2;
+	static const DWORD kStateSize = World::kStateSize;
+
+	Replay()
+	{
+		Start(ClassicRules::kId, 0, 0, kPathDirect);
+	}
+
+	void Start(BYTE newRules, uint64_t newSeed, DWORD newLevel, MonsterPathing newPathing)
+	{
+		rules = newRules;
+		pathing = (BYTE) newPathing;
+		seed = newSeed;
+		level = newLevel;
+		ticks = 0;
+		checksum = 0;
+		keyframeInterval = 0;
+		keyframeTicks.clear();
+		keyframes.clear();
+		for(DWORD s = 0; s < kNumStreams; s++)
+		{
+			streams[s].clear();
+		}
+	}
+
+	// Appends one tick: kNumPads button states and the connected mask
+	// (bit i for pad i).
+	void AddTick(const BYTE* pads, BYTE connected)
+	{
+		for(DWORD s = 0; s < kNumPads; s++)
+		{
+			Append(streams[s], pads[s]);
+		}
+		Append(streams[kConnectedStream], connected);
+		++ticks;
+	}
+
+	// Call before AddTick on every tick a multiple of interval, with the
+	// world as it is before that tick is played.
+	template<class Rules>
+	void AddKeyframe(const WorldT<Rules>& world, DWORD interval)
+	{
+		MyAssert(interval && ticks % interval == 0 && (keyframeInterval == 0 || keyframeInterval == interval));
+		keyframeInterval = interval;
+		keyframeTicks.push_back(ticks);
+		keyframes.push_back(std::vector<BYTE>(kStateSize));
+		world.WriteState(keyframes.back().data());
+	}
+
+	// Index of the last keyframe at or before tick, or -1 if there is none.
+	int FindKeyframe(DWORD tick) const
+	{
+		std::vector<DWORD>::const_iterator it = std::upper_bound(keyframeTicks.begin(), keyframeTicks.end(), tick);
+		return (int) (it - keyframeTicks.begin()) - 1;
+	}
+
+	// Reads the ticks back in order.
+	class Cursor
+	{
+	public:
+		explicit Cursor(const Replay& replay)
+			: replay(replay)
+		{
+			tick = 0;
+			for(DWORD s = 0; s < kNumStreams; s++)
+			{
+				run[s] = 0;
+				used[s] = 0;
+			}
+		}
+
+		bool Next(BYTE* pads, BYTE& connected)
+		{
+			if(tick >= replay.ticks)
+			{
+				return false;
+			}
+			for(DWORD s = 0; s < kNumPads; s++)
+			{
+				pads[s] = Take(s);
+			}
+			connected = Take(kConnectedStream);
+			++tick;
+			return true;
+		}
+
+		DWORD Tick() const
+		{
+			return tick;
+		}
+
+		// Moves to tick, which may be anywhere up to the end of the replay.
+		void Seek(DWORD newTick)
+		{
+			MyAssert(newTick <= replay.ticks);
+			tick = newTick;
+			for(DWORD s = 0; s < kNumStreams; s++)
+			{
+				const std::vector<Run>& stream = replay.streams[s];
+				DWORD r = (DWORD) (std::upper_bound(stream.begin(), stream.end(), newTick,
+					[](DWORD t, const Run& run) { return t < run.start; }) - stream.begin()) - 1;
+				if(newTick == replay.ticks)
+				{
+					r = (DWORD) stream.size();
+					used[s] = 0;
+				}
+				else
+				{
+					used[s] = newTick - stream[r].start;
+				}
+				run[s] = r;
+			}
+		}
+
+		// What the pads held on the tick before this one.
+		void Previous(BYTE* pads, BYTE& connected) const
+		{
+			for(DWORD s = 0; s < kNumStreams; s++)
+			{
+				DWORD r = run[s];
+				if(used[s] == 0)
+				{
+					--r;
+				}
+				BYTE value = tick ? replay.streams[s][r].value : 0;
+				if(s == kConnectedStream)
+				{
+					connected = value;
+				}
+				else
+				{
+					pads[s] = value;
+				}
+			}
+		}
+
+	private:
+		BYTE Take(DWORD s)
+		{
+			const Run& r = replay.streams[s][run[s]];
+			BYTE value = r.value;
+			if(++used[s] == r.length)
+			{
+				++run[s];
+				used[s] = 0;
+			}
+			return value;
+		}
+
+		const Replay& replay;
+		DWORD tick;
+		DWORD run[kNumStreams];
+		DWORD used[kNumStreams];
+	};
+
+	// Sets a game up the way the recording started.
+	template<class Rules>
+	void Begin(GameT<Rules>& game) const
+	{
+		MyAssert(rules == Rules::kId);
+		for(DWORD i = 0; i < kNumPads; i++)
+		{
+			game.SetButtons(i, 0);
+			game.SetConnected(i, false);
+		}
+		game.world.SetMonsterPathing((MonsterPathing) pathing);
+		game.Start(seed);
+		if(level != game.world.level)
+		{
+			game.world.LoadLevel(level);
+		}
+	}
+
+	// Plays every tick into a game set up by Begin.
+	template<class Rules>
+	void Play(GameT<Rules>& game) const
+	{
+		Cursor cursor(*this);
+		PlayTo(game, cursor, ticks);
+	}
+
+	// Plays the ticks from the cursor's up to (not including) endTick.
+	template<class Rules>
+	void PlayTo(GameT<Rules>& game, Cursor& cursor, DWORD endTick) const
+	{
+		BYTE pads[kNumPads];
+		BYTE connected;
+		while(cursor.Tick() < endTick && cursor.Next(pads, connected))
+		{
+			for(DWORD i = 0; i < kNumPads; i++)
+			{
+				game.SetConnected(i, (connected >> i) & 1);
+				game.SetButtons(i, pads[i]);
+			}
+			game.Step();
+		}
+	}
+
+	// Puts game in the state it had at the start of tick, from the nearest
+	// keyframe (or from Begin, if there is none), and the cursor there.
+	template<class Rules>
+	void Seek(GameT<Rules>& game, Cursor& cursor, DWORD tick) const
+	{
+		int k = FindKeyframe(tick);
+		if(k < 0)
+		{
+			Begin(game);
+			cursor.Seek(0);
+		}
+		else
+		{
+			game.world.SetMonsterPathing((MonsterPathing) pathing);
+			game.world.ReadState(keyframes[k].data());
+			cursor.Seek(keyframeTicks[k]);
+			BYTE pads[kNumPads];
+			BYTE connected;
+			cursor.Previous(pads, connected);
+			for(DWORD i = 0; i < kNumPads; i++)
+			{
+				game.gamepad[i] = GamePad();
+				game.SetButtons(i, pads[i]);
+				game.SetConnected(i, (connected >> i) & 1);
+			}
+		}
+		PlayTo(game, cursor, tick);
+	}
+
+	void Encode(std::vector<BYTE>& out) const;
+	bool Decode(const BYTE* data, size_t size);
+
+	bool Write(const char* path) const;
+	bool Read(const char* path);
+
+	BYTE rules;
+	BYTE pathing;
+	uint64_t seed;
+	DWORD level;
+	DWORD ticks;
+	uint64_t checksum;
+	std::vector<Run> streams[kNumStreams];
+	DWORD keyframeInterval;
+	std::vector<DWORD> keyframeTicks;
+	std::vector<std::vector<BYTE> > keyframes;	// Decoded, kStateSize bytes each
+
+private:
+	void Append(std::vector<Run>& stream, BYTE value)
+	{
+		if(!stream.empty() && stream.back().value == value)
+		{
+			++stream.back().length;
+		}
+		else
+		{
+			Run r;
+			r.value = value;
+			r.length = 1;
+			r.start = ticks;
+			stream.push_back(r);
+		}
+	}
+};
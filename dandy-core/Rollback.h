@@ -0,0 +1,253 @@
+#pragma once
+
+#include "ByteOrder.h"
+#include "Game.h"
+
+// Rollback netcode for online co-op. Every peer runs the whole game and
+// owns one player's pad. A peer never waits for the others' inputs: it
+// predicts each remote pad by repeating its last confirmed input, saves a
+// snapshot before every frame, and when a confirmed input turns out to
+// differ from what was predicted, it restores the snapshot of that frame
+// and simulates forward again with the real input. All peers therefore end
+// up with bit-identical worlds once every input has arrived.
+//
+// A peer may run at most kMaxPrediction frames past the last frame for
+// which it has every player's input, so a rollback never re-simulates more
+// than that. Packets carry every local input the receiver has not yet
+// acknowledged, so a lost packet is covered by the next one.
+//
+// The session only builds and reads packets; moving them is up to the
+// caller (see LoopbackNetwork for a stand-in with latency and loss).
+template<class Rules>
+class RollbackSessionT
+{
+public:
+	typedef GameT<Rules> GameType;
+	static const DWORD PlayerCount = GameType::PlayerCount;
+
+	// Frames a peer may run ahead of its confirmed inputs.
+	static const DWORD kMaxPrediction = 10;
+	// Snapshots kept; must exceed kMaxPrediction.
+	static const DWORD kSnapshotRing = 16;
+	// Inputs kept per player; covers what a packet may still resend and
+	// what a peer up to kMaxPrediction frames ahead may send.
+	static const DWORD kInputRing = 64;
+
+	static const DWORD kPacketHeader = 11;
+	static const DWORD kMaxPacketInputs = 40;
+	static const DWORD kMaxPacketSize = kPacketHeader + kMaxPacketInputs;
+	static const BYTE kPacketInputs = 'I';
+
+	struct Stats
+	{
+		DWORD frames;
+		DWORD stalls;
+		DWORD rollbacks;
+		DWORD resimulated;
+		DWORD maxResimulated;
+		DWORD packetsRead;
+		DWORD packetsRejected;
+	};
+
+	RollbackSessionT()
+	{
+		Start(0, 0, 1);
+	}
+
+	// Starts a game on every peer from the same seed. numPeers players take
+	// part, player i being owned by peer i; the others' pads stay released.
+	void Start(uint64_t seed, DWORD localPlayer, DWORD numPeers)
+	{
+		MyAssert(localPlayer < numPeers && numPeers <= PlayerCount);
+		local = localPlayer;
+		peers = numPeers;
+		frame = 0;
+		rollbackFrame = kNoRollback;
+		memset(&stats, 0, sizeof(stats));
+		for(DWORD p = 0; p < PlayerCount; p++)
+		{
+			confirmed[p] = p < peers ? 0 : kAlwaysConfirmed;
+			acked[p] = 0;
+			game.SetButtons(p, 0);
+			game.SetConnected(p, p < peers);
+		}
+		memset(input, 0, sizeof(input));
+		memset(used, 0, sizeof(used));
+		game.Start(seed);
+	}
+
+	// First frame for which some player's input is still unknown. Every
+	// frame before it is final.
+	DWORD SyncFrame() const
+	{
+		DWORD sync = frame;
+		for(DWORD p = 0; p < peers; p++)
+		{
+			sync = std::min(sync, confirmed[p]);
+		}
+		return sync;
+	}
+
+	// False while the peer is as far ahead of the slowest input (or of
+	// what the others have acknowledged) as it may get; the caller then
+	// skips this frame and keeps exchanging packets.
+	bool CanAdvance() const
+	{
+		if(frame >= SyncFrame() + kMaxPrediction)
+		{
+			return false;
+		}
+		for(DWORD p = 0; p < peers; p++)
+		{
+			if(p != local && frame - acked[p] >= kMaxPacketInputs)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Simulates one frame with this peer's pad state, first rolling back
+	// for any input that arrived since the last frame.
+	bool AdvanceFrame(BYTE buttons)
+	{
+		if(!CanAdvance())
+		{
+			++stats.stalls;
+			return false;
+		}
+		input[frame % kInputRing][local] = buttons;
+		confirmed[local] = frame + 1;
+		Synchronize();
+		SimulateFrame(frame);
+		++frame;
+		++stats.frames;
+		return true;
+	}
+
+	// Re-simulates from the earliest mispredicted frame, if any.
+	void Synchronize()
+	{
+		if(rollbackFrame >= frame)
+		{
+			rollbackFrame = kNoRollback;
+			return;
+		}
+		DWORD count = frame - rollbackFrame;
+		game.Restore(snapshot[rollbackFrame % kSnapshotRing]);
+		for(DWORD f = rollbackFrame; f < frame; f++)
+		{
+			SimulateFrame(f);
+		}
+		++stats.rollbacks;
+		stats.resimulated += count;
+		stats.maxResimulated = std::max(stats.maxResimulated, count);
+		rollbackFrame = kNoRollback;
+	}
+
+	// Writes the packet for the peer that owns toPlayer: the local inputs
+	// it has not acknowledged and how many of its own inputs we have.
+	// Returns the packet size.
+	DWORD WritePacket(DWORD toPlayer, BYTE* packet) const
+	{
+		MyAssert(toPlayer < peers && toPlayer != local);
+		DWORD first = acked[toPlayer];
+		DWORD count = frame - first;
+		if(count > kMaxPacketInputs)
+		{
+			count = kMaxPacketInputs;
+		}
+		packet[0] = kPacketInputs;
+		packet[1] = (BYTE) local;
+		Write32(packet + 2, confirmed[toPlayer]);
+		Write32(packet + 6, first);
+		packet[10] = (BYTE) count;
+		for(DWORD i = 0; i < count; i++)
+		{
+			packet[kPacketHeader + i] = input[(first + i) % kInputRing][local];
+		}
+		return kPacketHeader + count;
+	}
+
+	// Takes in a packet from another peer. Inputs are only accepted in
+	// order; anything already known is ignored, and a gap (a reordered
+	// packet) waits for the resend. Returns false for a malformed packet.
+	bool ReadPacket(const BYTE* packet, DWORD size)
+	{
+		if(size < kPacketHeader || packet[0] != kPacketInputs || packet[1] >= peers
+			|| packet[1] == local || size != kPacketHeader + packet[10])
+		{
+			++stats.packetsRejected;
+			return false;
+		}
+		DWORD from = packet[1];
+		DWORD ack = Read32(packet + 2);
+		DWORD first = Read32(packet + 6);
+		DWORD count = packet[10];
+		if(ack > frame || first + count > SyncFrame() + kInputRing - kMaxPrediction)
+		{
+			++stats.packetsRejected;
+			return false;
+		}
+		acked[from] = std::max(acked[from], ack);
+		for(DWORD f = std::max(first, confirmed[from]); f < first + count; f++)
+		{
+			if(f != confirmed[from])
+			{
+				break;
+			}
+			BYTE buttons = packet[kPacketHeader + (f - first)];
+			input[f % kInputRing][from] = buttons;
+			confirmed[from] = f + 1;
+			if(f < frame && used[f % kInputRing][from] != buttons)
+			{
+				rollbackFrame = std::min(rollbackFrame, f);
+			}
+		}
+		++stats.packetsRead;
+		return true;
+	}
+
+	// The input a remote player is assumed to hold until theirs arrives.
+	BYTE Predict(DWORD player) const
+	{
+		DWORD known = confirmed[player];
+		return known ? input[(known - 1) % kInputRing][player] : 0;
+	}
+
+	GameType game;
+	DWORD local;
+	DWORD peers;
+	DWORD frame;		// Next frame to simulate
+	Stats stats;
+
+private:
+	void SimulateFrame(DWORD f)
+	{
+		game.Save(snapshot[f % kSnapshotRing]);
+		for(DWORD p = 0; p < PlayerCount; p++)
+		{
+			BYTE buttons = 0;
+			if(p < peers)
+			{
+				buttons = f < confirmed[p] ? input[f % kInputRing][p] : Predict(p);
+			}
+			used[f % kInputRing][p] = buttons;
+			game.SetButtons(p, buttons);
+		}
+		game.Step();
+	}
+
+	static const DWORD kNoRollback = 0xffffffff;
+	static const DWORD kAlwaysConfirmed = 0xffffffff;
+
+	DWORD rollbackFrame;		// Earliest frame simulated with a wrong guess
+	DWORD confirmed[PlayerCount];	// Frames of each player's input known here
+	DWORD acked[PlayerCount];	// Frames of our input each peer has confirmed
+	BYTE input[kInputRing][PlayerCount];
+	BYTE used[kInputRing][PlayerCount];	// What each frame was simulated with
+	typename GameType::Snapshot snapshot[kSnapshotRing];
+};
+
+typedef RollbackSessionT<ClassicRules> RollbackSession;
+typedef RollbackSessionT<Xbox360Rules> RollbackSession360;
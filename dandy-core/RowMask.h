@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Bitboards.h"
+
+#include <string.h>
+#include <type_traits>
+
+// One bit per map row, for the rows written since a map was last saved
+// or restored. A classic map's rows fit one DWORD.
+template<DWORD Rows>
+class RowMask
+{
+public:
+	void Clear()
+	{
+		memset(words, 0, sizeof(words));
+	}
+
+	void SetAll()
+	{
+		memset(words, 0xff, sizeof(words));
+		if(Rows % kWordBits)
+		{
+			words[kNumWords - 1] = (Word) ((1ULL << (Rows % kWordBits)) - 1);
+		}
+	}
+
+	void Set(DWORD row)
+	{
+		words[WordOf(row)] |= (Word) 1 << (row % kWordBits);
+	}
+
+	bool Test(DWORD row) const
+	{
+		return (words[WordOf(row)] >> (row % kWordBits)) & 1;
+	}
+
+	DWORD Count() const
+	{
+		DWORD count = 0;
+		for(DWORD w = 0; w < kNumWords; w++)
+		{
+			count += PopCount64(words[w]);
+		}
+		return count;
+	}
+
+	// Calls fn(row) for every set row, in order.
+	template<class F>
+	void ForEach(F fn) const
+	{
+		for(DWORD w = 0; w < kNumWords; w++)
+		{
+			for(Word bits = words[w]; bits; bits &= bits - 1)
+			{
+				fn(w * kWordBits + CountTrailingZeros64(bits));
+			}
+		}
+	}
+
+private:
+	typedef typename std::conditional<Rows <= 32, DWORD, uint64_t>::type Word;
+	static const DWORD kWordBits = sizeof(Word) * 8;
+	static const DWORD kNumWords = (Rows + kWordBits - 1) / kWordBits;
+
+	static DWORD WordOf(DWORD row)
+	{
+		MyBoundsCheck(row < Rows);
+		return kNumWords == 1 ? 0 : row / kWordBits;
+	}
+
+	Word words[kNumWords];
+};
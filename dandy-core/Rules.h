@@ -0,0 +1,49 @@
+#pragma once
+
+#include "DandyTypes.h"
+
+// The rules that differ between the Windows game (dandy-c++) and the Xbox
+// 360 port (dandy-360). WorldT and GameT take one of these as a template
+// parameter; every member is a compile-time constant, so each variant is
+// compiled on its own and never tests a rules flag at run time.
+struct ClassicRules
+{
+	// Identifies the rules in files that record a game (Replay).
+	static const BYTE kId = 0;
+
+	// Health a new player starts with, and what eating food restores.
+	static const BYTE kHealthMax = 9;
+
+	// Players in the game after Init. The rest wait as kNotInGame.
+	static const DWORD kStartPlayers = 2;
+
+	// A diagonal move into a wall slides along it instead (IsSlidable).
+	static const bool kWallSliding = false;
+
+	// Players join when their pad connects and drop out when it goes
+	// (GameT::SetConnected, World AddPlayer/KillPlayer).
+	static const bool kHotJoin = false;
+
+	// The active region is fixed at the start of the tick, and arrows that
+	// leave it die.
+	static const bool kArrowsStayInView = false;
+
+	// An arrow knocks smileys, bigs and the stronger generators down one
+	// kind instead of destroying them.
+	static const bool kArrowsWeaken = false;
+
+	// With nobody visible, the view centres on the level's kUp.
+	static const bool kCentreOnEntrance = false;
+};
+
+struct Xbox360Rules
+{
+	static const BYTE kId = 1;
+	static const BYTE kHealthMax = 10;
+	static const DWORD kStartPlayers = 0;
+	static const bool kWallSliding = true;
+	static const bool kHotJoin = true;
+	static const bool kArrowsStayInView = true;
+	static const bool kArrowsWeaken = true;
+	static const bool kCentreOnEntrance = true;
+};
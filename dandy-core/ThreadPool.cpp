@@ -0,0 +1,138 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(DWORD numThreads)
+	: queued(0), quit(false)
+{
+	if(numThreads == kThreadPoolAuto)
+	{
+		DWORD hardware = std::thread::hardware_concurrency();
+		numThreads = hardware > 1 ? hardware - 1 : 0;
+	}
+	// One extra queue belongs to whichever outside thread calls Run().
+	for(DWORD i = 0; i <= numThreads; i++)
+	{
+		queues.push_back(new Queue);
+	}
+	for(DWORD i = 0; i < numThreads; i++)
+	{
+		workers.push_back(std::thread(&ThreadPool::WorkerMain, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		quit = true;
+	}
+	wake.notify_all();
+	for(size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	for(size_t i = 0; i < queues.size(); i++)
+	{
+		delete queues[i];
+	}
+}
+
+void ThreadPool::Run(DWORD count, DWORD grain, RangeFunc func, void* context)
+{
+	Job job;
+	job.func = func;
+	job.context = context;
+	DWORD numTasks = (count + grain - 1) / grain;
+	job.pending = numTasks;
+
+	// Deal the chunks out round-robin; stealing evens out whatever is left.
+	DWORD numQueues = (DWORD) queues.size();
+	for(DWORD i = 0; i < numTasks; i++)
+	{
+		Task task;
+		task.job = &job;
+		task.begin = i * grain;
+		task.end = std::min(count, task.begin + grain);
+		Queue* q = queues[i % numQueues];
+		std::lock_guard<std::mutex> guard(q->lock);
+		q->tasks.push_back(task);
+	}
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		queued += numTasks;
+	}
+	wake.notify_all();
+
+	DWORD self = numQueues - 1;
+	Task task;
+	while(job.pending.load(std::memory_order_acquire) != 0)
+	{
+		if(PopOrSteal(self, task))
+		{
+			Execute(task);
+		}
+		else
+		{
+			std::unique_lock<std::mutex> guard(sleepLock);
+			done.wait(guard, [&] { return job.pending.load(std::memory_order_acquire) == 0 || queued != 0; });
+		}
+	}
+}
+
+bool ThreadPool::PopOrSteal(DWORD self, Task& task)
+{
+	{
+		Queue* q = queues[self];
+		std::lock_guard<std::mutex> guard(q->lock);
+		if(!q->tasks.empty())
+		{
+			task = q->tasks.back();
+			q->tasks.pop_back();
+			--queued;
+			return true;
+		}
+	}
+	DWORD numQueues = (DWORD) queues.size();
+	for(DWORD i = 1; i < numQueues; i++)
+	{
+		Queue* q = queues[(self + i) % numQueues];
+		std::lock_guard<std::mutex> guard(q->lock);
+		if(!q->tasks.empty())
+		{
+			task = q->tasks.front();
+			q->tasks.pop_front();
+			--queued;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::Execute(const Task& task)
+{
+	Job* job = task.job;
+	job->func(job->context, task.begin, task.end);
+	if(job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		done.notify_all();
+	}
+}
+
+void ThreadPool::WorkerMain(DWORD self)
+{
+	Task task;
+	for(;;)
+	{
+		if(PopOrSteal(self, task))
+		{
+			Execute(task);
+			continue;
+		}
+		std::unique_lock<std::mutex> guard(sleepLock);
+		wake.wait(guard, [&] { return quit || queued != 0; });
+		if(quit)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "DandyTypes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads with one task deque per worker. A
+// worker pops from the back of its own deque and, when that runs dry,
+// steals from the front of the others, so uneven work (a world that just
+// loaded a level, a stripe full of monsters) balances itself out.
+//
+// The calling thread helps run tasks while it waits, so a pool of N threads
+// keeps N + 1 cores busy; a pool created with one thread per core therefore
+// uses NumThreads() == hardware_concurrency - 1.
+
+// Worker count that picks one worker per hardware thread, leaving one for
+// the caller.
+const DWORD kThreadPoolAuto = 0xffffffff;
+
+class ThreadPool
+{
+public:
+	// numThreads workers, or kThreadPoolAuto. With 0 the caller runs every
+	// task itself.
+	explicit ThreadPool(DWORD numThreads = kThreadPoolAuto);
+	~ThreadPool();
+
+	DWORD NumThreads() const
+	{
+		return (DWORD) workers.size();
+	}
+
+	// Calls fn(begin, end) over [0, count) in chunks of at most grain items
+	// and returns once every chunk has run. Chunks may run on any thread in
+	// any order, so fn must only touch state owned by its own range.
+	template<class F>
+	void ParallelFor(DWORD count, DWORD grain, const F& fn)
+	{
+		if(count == 0)
+		{
+			return;
+		}
+		if(grain == 0)
+		{
+			grain = 1;
+		}
+		if(workers.empty() || count <= grain)
+		{
+			fn(0u, count);
+			return;
+		}
+		Run(count, grain, &CallRange<F>, (void*) &fn);
+	}
+
+private:
+	typedef void (*RangeFunc)(void* context, DWORD begin, DWORD end);
+
+	template<class F>
+	static void CallRange(void* context, DWORD begin, DWORD end)
+	{
+		(*(const F*) context)(begin, end);
+	}
+
+	struct Job
+	{
+		RangeFunc func;
+		void* context;
+		std::atomic<DWORD> pending;
+	};
+
+	struct Task
+	{
+		Job* job;
+		DWORD begin;
+		DWORD end;
+	};
+
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<Task> tasks;
+	};
+
+	void Run(DWORD count, DWORD grain, RangeFunc func, void* context);
+	bool PopOrSteal(DWORD self, Task& task);
+	void Execute(const Task& task);
+	void WorkerMain(DWORD self);
+
+	std::vector<std::thread> workers;
+	std::vector<Queue*> queues;
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	std::atomic<DWORD> queued;
+	bool quit;
+};
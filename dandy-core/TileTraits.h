@@ -0,0 +1,99 @@
+#pragma once
+
+#include "DandyTypes.h"
+#include "MapData.h"
+
+// Everything the rules need to know about a kind of cell, in one table
+// indexed by MapData. Hot loops classify a cell with one load and one AND
+// instead of a chain of range tests and switches.
+enum TileFlag
+{
+	kTileMonster = 1 << 0,		// kGhost, kSmiley, kBig
+	kTileGenerator = 1 << 1,	// kGen1 .. kGen3
+	kTileArrow = 1 << 2,		// kArrow0 .. kArrow7
+	kTilePlayer = 1 << 3,		// kPlayer0 .. kPlayer3
+	kTileWalkable = 1 << 4,		// A player steps onto it, collecting any pickup
+	kTileArrowPath = 1 << 5,	// An arrow flies through it (Arrow::CanGo)
+	kTileArrowTarget = 1 << 6,	// An arrow hits it (Arrow::CanHit)
+	kTileMonsterStep = 1 << 7,	// A monster moves into it, or attacks it
+	kTileMonsterPath = 1 << 8,	// Open for monster path finding (IsMonsterPath)
+	kTileSlidable = 1 << 9,		// A player can slide onto it along a wall (IsSlidable)
+
+	kTileEntity = kTileMonster | kTileGenerator
+};
+
+struct TileTraits
+{
+	WORD flags;
+	BYTE damage;	// Health a monster takes from a player it reaches
+	BYTE spawn;		// What a generator spawns
+	BYTE weakened;	// What an arrow hit leaves under kArrowsWeaken
+	// Pickup effect, added to the player who steps on it
+	BYTE keys;
+	BYTE food;
+	BYTE bombs;
+	BYTE score;
+};
+
+const WORD kTileArrowSpace = kTileWalkable | kTileArrowPath | kTileMonsterStep | kTileMonsterPath | kTileSlidable;
+const WORD kTileMonsterFlags = kTileMonster | kTileArrowTarget | kTileMonsterPath;
+const WORD kTileGeneratorFlags = kTileGenerator | kTileArrowTarget;
+const WORD kTileArrowFlags = kTileArrow | kTileMonsterPath;
+const WORD kTilePlayerFlags = kTilePlayer | kTileMonsterStep | kTileMonsterPath;
+
+constexpr TileTraits kTileTraits[kNumMapData] =
+{
+	//	flags												damage	spawn	weakened	keys food bombs score
+	{ kTileArrowSpace,										0, 0, kSpace,		0, 0, 0, 0 },	// kSpace
+	{ 0,													0, 0, kSpace,		0, 0, 0, 0 },	// kWall
+	{ 0,													0, 0, kSpace,		0, 0, 0, 0 },	// kLock
+	{ 0,													0, 0, kSpace,		0, 0, 0, 0 },	// kUp
+	{ kTileSlidable,										0, 0, kSpace,		0, 0, 0, 0 },	// kDown
+	{ kTileWalkable | kTileSlidable,						0, 0, kSpace,		1, 0, 0, 0 },	// kKey
+	{ kTileWalkable | kTileSlidable,						0, 0, kSpace,		0, 1, 0, 0 },	// kFood
+	{ kTileWalkable | kTileSlidable,						0, 0, kSpace,		0, 0, 0, 10 },	// kMoney
+	{ kTileWalkable | kTileSlidable | kTileArrowTarget,		0, 0, kSpace,		0, 0, 1, 0 },	// kBomb
+	{ kTileMonsterFlags,									1, 0, kSpace,		0, 0, 0, 0 },	// kGhost
+	{ kTileMonsterFlags,									2, 0, kGhost,		0, 0, 0, 0 },	// kSmiley
+	{ kTileMonsterFlags,									3, 0, kSmiley,		0, 0, 0, 0 },	// kBig
+	{ kTileArrowTarget,										0, 0, kSpace,		0, 0, 0, 0 },	// kHeart
+	{ kTileGeneratorFlags,									0, kGhost, kSpace,	0, 0, 0, 0 },	// kGen1
+	{ kTileGeneratorFlags,									0, kSmiley, kGen1,	0, 0, 0, 0 },	// kGen2
+	{ kTileGeneratorFlags,									0, kBig, kGen2,		0, 0, 0, 0 },	// kGen3
+	{ kTileArrowFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kArrow0
+	{ kTileArrowFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kArrow1
+	{ kTileArrowFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kArrow2
+	{ kTileArrowFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kArrow3
+	{ kTileArrowFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kArrow4
+	{ kTileArrowFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kArrow5
+	{ kTileArrowFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kArrow6
+	{ kTileArrowFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kArrow7
+	{ kTilePlayerFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kPlayer0
+	{ kTilePlayerFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kPlayer1
+	{ kTilePlayerFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kPlayer2
+	{ kTilePlayerFlags,										0, 0, kSpace,		0, 0, 0, 0 },	// kPlayer3
+};
+
+inline const TileTraits& TraitsOf(BYTE d)
+{
+	MyBoundsCheck(d < kNumMapData);
+	return kTileTraits[d];
+}
+
+inline bool HasTrait(BYTE d, WORD flags)
+{
+	return (TraitsOf(d).flags & flags) != 0;
+}
+
+// Cells a monster can path through: empty, or holding something that will
+// move out of the way (an arrow, a player, another monster).
+inline bool IsMonsterPath(BYTE d)
+{
+	return HasTrait(d, kTileMonsterPath);
+}
+
+// Cells a player can slide onto along a wall (Xbox 360 rules).
+inline bool IsSlidable(MapData d)
+{
+	return HasTrait(d, kTileSlidable);
+}
@@ -0,0 +1,1129 @@
+#pragma once
+
+#include "ByteOrder.h"
+#include "FlowField.h"
+#include "Player.h"
+#include "Random.h"
+#include "Rules.h"
+#include "ThreadPool.h"
+
+// How monsters pick the direction to move in.
+enum MonsterPathing
+{
+	kPathDirect,	// Straight at the nearest player, ignoring walls
+	kPathFlowField	// Along a per-tick BFS field that routes around walls
+};
+
+// The game rules, driven by a logical tick counter instead of the wall
+// clock. One call to Update() advances the world by one 1/60 s tick, so a
+// World can be stepped as fast as the CPU allows, and two worlds given the
+// same seed and the same inputs stay bit-identical.
+//
+// Rules (see Rules.h) selects the Windows or the Xbox 360 variant of the
+// game at compile time, and Geometry (see MapGeometry.h) the size of the
+// map.
+template<class Rules, class Geometry = ClassicGeometry>
+class WorldT
+{
+public:
+	// The map, players and coordinates of this geometry; the names are the
+	// classic ones so the rules below read the same for every size.
+	typedef MapT<Geometry> Map;
+	typedef typename Geometry::Coord Coord;
+	typedef PlayerT<Coord> Player;
+	typedef ArrowT<Coord> Arrow;
+	typedef typename Map::EntityIndex EntityIndex;
+
+	// A run of activeEntities that share one lattice row.
+	struct Stripe
+	{
+		DWORD row;
+		DWORD begin;
+		DWORD end;
+	};
+
+	// Game state saved by Save (defined below, after PlayerCount).
+	struct Snapshot;
+
+	WorldT()
+	{
+		level = 0;
+		numPlayers = 0;
+		tick = 0;
+		numTargets = 0;
+		startX = startY = endX = endY = 0;
+		monsterPool = NULL;
+		pathing = kPathDirect;
+	}
+
+	void Seed(uint64_t seed)
+	{
+		rng.Seed(seed);
+	}
+
+	void Init()
+	{
+		map.Init();
+		numPlayers = Rules::kStartPlayers;
+		tick = 0;
+		startX = startY = endX = endY = 0;
+		for(DWORD i = 0; i < PlayerCount; i++)
+		{
+			player[i].Init(Rules::kHealthMax);
+			player[i].state = i < numPlayers ? kNormal : kNotInGame;
+		}
+	}
+
+	void Update()
+	{
+		++tick;
+
+		if constexpr(Rules::kArrowsStayInView)
+		{
+			UpdateActiveRegion();
+		}
+
+		for(DWORD i = 0; i < numPlayers; i++)
+		{
+			DoArrowMove(&player[i], false);
+		}
+
+		if constexpr(!Rules::kArrowsStayInView)
+		{
+			UpdateActiveRegion();
+		}
+		DoMonsters();
+	}
+
+	// The region monsters update in (and, with kArrowsStayInView, arrows
+	// live in) for this tick.
+	void UpdateActiveRegion()
+	{
+		float cogX;
+		float cogY;
+		GetCOG(cogX, cogY);
+		map.GetActive(cogX, cogY, startX, startY, endX, endY);
+	}
+
+	bool IsGameOver()
+	{
+		for(DWORD i = 0; i < numPlayers; i++)
+		{
+			if(player[i].IsAlive())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Monsters only update on one cell of every 3x3 block per tick, and a
+	// monster or generator only touches the 3x3 block around itself, so no
+	// two cells updated in the same tick can affect each other. That lets
+	// the lattice rows ("stripes") run on separate threads. Each stripe draws
+	// from its own generator seeded from the world's stream, and monsters
+	// chase the players as they stood at the start of the pass, so the result
+	// is identical however the stripes are scheduled.
+	void DoMonsters()
+	{
+		numTargets = 0;
+		for(DWORD i = 0; i < numPlayers; i++)
+		{
+			if(player[i].IsVisible())
+			{
+				targetX[numTargets] = player[i].x;
+				targetY[numTargets] = player[i].y;
+				++numTargets;
+			}
+		}
+
+		// update in a grid pattern
+		int gridStep = tick % 9;
+		int gridXOffset = gridStep % 3;
+		int gridYOffset = gridStep / 3;
+		DWORD firstX = startX + gridXOffset;
+		DWORD firstY = startY + gridYOffset;
+		uint64_t stripeSeed = ((uint64_t) rng.Next() << 32) | rng.Next();
+
+		// This tick's lattice cells are exactly one entity bucket, already in
+		// the row-major order the lattice scan used to visit them. Copy out
+		// the ones inside the active region (the bucket changes as monsters
+		// move) and cut them into one stripe per row.
+		const std::vector<EntityIndex>& bucket = map.entities.Bucket(firstX % 3, firstY % 3);
+		activeEntities.clear();
+		bool anyMonsters = false;
+		typename std::vector<EntityIndex>::const_iterator it =
+			std::lower_bound(bucket.begin(), bucket.end(), (EntityIndex) (firstY * Map::Width));
+		for(; it != bucket.end(); ++it)
+		{
+			DWORD index = *it;
+			if(index >= endY * Map::Width)
+			{
+				break;
+			}
+			DWORD x = index % Map::Width;
+			if(x >= firstX && x < endX)
+			{
+				activeEntities.push_back(*it);
+				anyMonsters |= HasTrait(map.Cell[index], kTileMonster);
+			}
+		}
+
+		stripes.clear();
+		for(DWORD i = 0; i < activeEntities.size(); )
+		{
+			Stripe stripe;
+			DWORD y = activeEntities[i] / Map::Width;
+			stripe.row = (y - firstY) / 3;
+			stripe.begin = i;
+			while(i < activeEntities.size() && activeEntities[i] / Map::Width == y)
+			{
+				i++;
+			}
+			stripe.end = i;
+			stripes.push_back(stripe);
+		}
+
+		if(pathing == kPathFlowField && numTargets && anyMonsters)
+		{
+			flowField.Update(map, startX, startY, endX, endY, targetX, targetY, numTargets);
+		}
+
+		DWORD numStripes = (DWORD) stripes.size();
+		if(monsterPool && numStripes >= kMinParallelStripes)
+		{
+			if(stripeLogs.size() < numStripes)
+			{
+				stripeLogs.resize(numStripes);
+			}
+			monsterPool->ParallelFor(numStripes, 1, [&](DWORD begin, DWORD end)
+			{
+				for(DWORD s = begin; s < end; s++)
+				{
+					stripeLogs[s].clear();
+					DoMonsterStripe(stripes[s], stripeSeed, &stripeLogs[s]);
+				}
+			});
+			for(DWORD s = 0; s < numStripes; s++)
+			{
+				map.ApplyChanges(stripeLogs[s]);
+			}
+		}
+		else
+		{
+			for(DWORD s = 0; s < numStripes; s++)
+			{
+				DoMonsterStripe(stripes[s], stripeSeed, NULL);
+			}
+		}
+	}
+
+	// Updates one stripe. With a log, map writes are deferred to it so that
+	// stripes on other threads never touch the shared entity list.
+	void DoMonsterStripe(const Stripe& stripe, uint64_t stripeSeed, std::vector<CellChange>* log)
+	{
+		Random stripeRng(Random::Mix(stripeSeed + stripe.row));
+		for(DWORD i = stripe.begin; i < stripe.end; i++)
+		{
+			DWORD index = activeEntities[i];
+			MapData d = map.GetIndex(index);
+			const TileTraits& traits = TraitsOf(d);
+			if(traits.flags & kTileMonster)
+			{
+				// Move towards nearest player
+				DWORD x = index % Map::Width;
+				DWORD y = index / Map::Width;
+				Direction dir = kDirNone;
+				// The field is only rebuilt while someone is visible; with
+				// nobody to chase it is stale, and monsters stay put as they
+				// do with direct pathing.
+				if(pathing == kPathFlowField && numTargets)
+				{
+					dir = flowField.Get(x, y);
+				}
+				if(dir == kDirNone)
+				{
+					dir = GetDirectionOfNearestPlayer(x, y);
+				}
+				if(dir != kDirNone)
+				{
+					DWORD to = index;
+					bool canMove = false;
+					MapData d2 = kSpace;
+					for(int test = 0; test < 3; test++)
+					{
+						const static int kTestDelta[3] = {0,-1,1};
+						to = index + Map::Step((dir + kTestDelta[test]) & 7);
+						d2 = map.GetIndex(to);
+						if(HasTrait(d2, kTileMonsterStep))
+						{
+							canMove = true;
+							break;
+						}
+					}
+					if(canMove)
+					{
+						StripeSet(index, kSpace, log);
+						if(HasTrait(d2, kTilePlayer))
+						{
+							Player* p = &player[d2 - kPlayer0];
+							int monsterHit = traits.damage;
+							if(p->health > monsterHit)
+							{
+								p->health -= monsterHit;
+							}
+							else
+							{
+								p->health = 0;
+								MapData remains = kSpace;
+								if(p->keys)
+								{
+									--p->keys;
+									remains = kKey;
+								}
+								StripeSet(to, remains, log);
+							}
+						}
+						else
+						{
+							StripeSet(to, d, log);
+						}
+					}
+				}
+			}
+			else if(traits.flags & kTileGenerator)
+			{
+				// Random generator
+				if(stripeRng.Get(10) < 3)
+				{
+					DWORD to = index + Map::Step(stripeRng.Get(4) * 2);
+					if(map.GetIndex(to) == kSpace)
+					{
+						StripeSet(to, traits.spawn, log);
+					}
+				}
+			}
+		}
+	}
+
+	void StripeSet(DWORD index, int v, std::vector<CellChange>* log)
+	{
+		if(log)
+		{
+			map.SetDeferred(index, v, *log);
+		}
+		else
+		{
+			map.SetIndex(index, (BYTE) v);
+		}
+	}
+
+	void SetMonsterPathing(MonsterPathing newPathing)
+	{
+		pathing = newPathing;
+	}
+
+	MonsterPathing GetMonsterPathing() const
+	{
+		return pathing;
+	}
+
+	// Run DoMonsters stripes on this pool, or serially when it is NULL.
+	void SetMonsterPool(ThreadPool* pool)
+	{
+		monsterPool = pool;
+	}
+
+	// Nearest of the players that were visible when this tick's monster
+	// pass began.
+	Direction GetDirectionOfNearestPlayer(DWORD x, DWORD y)
+	{
+		DWORD bestX = 0;
+		DWORD bestY = 0;
+		DWORD bestDistance = 10000;
+		for(DWORD i = 0; i < numTargets; i++)
+		{
+			DWORD distance = abs((int) (targetX[i] - x)) + abs((int) (targetY[i] - y));
+			if(distance < bestDistance)
+			{
+				bestDistance = distance;
+				bestX = targetX[i];
+				bestY = targetY[i];
+			}
+		}
+		if(bestDistance == 10000)
+		{
+			return kDirNone;
+		}
+		int dx = bestX - x;
+		int dy = bestY - y;
+		BYTE bitField = 0;
+		if(dy > 0) bitField |= 8;
+		else if(dy < 0) bitField |= 4;
+		if(dx > 0) bitField |= 2;
+		else if(dx < 0) bitField |= 1;
+
+		//     7 0 1
+		//     6 + 2
+		//     5 4 3
+
+		const static BYTE kDirTable[16] =
+		{
+			   // YyXx
+			255, // 0000
+			6, // 0001
+			2, // 0010
+			255, // 0011
+			0, // 0100
+			7, // 0101
+			1, // 0110
+			255, // 0111
+			4, // 1000
+			5, // 1001
+			3, // 1010
+			255, // 1011
+			255, // 1100
+			255, // 1101
+			255, // 1110
+			255, // 1111
+		};
+
+		return (Direction) kDirTable[bitField];
+	}
+
+	void GetCOG(float& x, float& y)
+	{
+		x = 0.f;
+		y = 0.f;
+		int liveCount = 0;
+		for(DWORD i = 0; i < numPlayers; i++)
+		{
+			Player *pP = &player[i];
+			if(pP->IsVisible())
+			{
+				x += pP->x;
+				y += pP->y;
+				++liveCount;
+			}
+		}
+		if(liveCount)
+		{
+			x /= liveCount;
+			y /= liveCount;
+		}
+		else if constexpr(Rules::kCentreOnEntrance)
+		{
+			Coord ux;
+			Coord uy;
+			FindUp(ux, uy);
+			x = ux;
+			y = uy;
+		}
+	}
+
+	void LoadLevel(DWORD index)
+	{
+		if(map.LoadLevel(index))
+		{
+			level = index;
+		}
+		else
+		{
+			level = 0;
+			map.LoadLevel(0);
+		}
+		SetPlayerPositions();
+	}
+
+	void ChangeLevel(int delta)
+	{
+		DWORD newLevel = std::min<DWORD>(Map::LevelCount(), level + delta);
+		LoadLevel(newLevel);
+	}
+
+	void FindUp(Coord& x, Coord& y)
+	{
+		if(!map.Find(x, y, kUp))
+		{
+			MyDebugBreak();
+			x = 4;
+			y = 4;
+		}
+	}
+
+	void SetPlayerPositions()
+	{
+		Coord x;
+		Coord y;
+		FindUp(x, y);
+		for(DWORD i = 0; i < numPlayers; i++)
+		{
+			Player* p = &player[i];
+			if(p->IsAlive())
+			{
+				Coord px = x;
+				Coord py = y;
+				MoveToStart(px, py, i);
+				PlaceInWorld(i, px, py);
+			}
+		}
+	}
+
+	// A player joining a game in progress starts next to the entrance.
+	void AddPlayer(DWORD index)
+	{
+		Coord x;
+		Coord y;
+		FindUp(x, y);
+		Player* p = &player[index];
+		MyAssert(!p->IsAlive());
+		p->Init(Rules::kHealthMax);
+		numPlayers = std::max(numPlayers, index + 1);
+		MoveToStart(x, y, index);
+		PlaceInWorld(index, x, y);
+	}
+
+	// Moves (x, y), the entrance, to where player index starts: the next
+	// cell in direction index * 2, or the next direction round from it that
+	// is not on the map's outer ring. An entrance next to the edge would
+	// otherwise put a player on the border, where every Step leaves Cell.
+	static void MoveToStart(Coord& x, Coord& y, DWORD index)
+	{
+		for(DWORD k = 0; k < 8; k++)
+		{
+			Coord px = x;
+			Coord py = y;
+			MoveCoords(px, py, (index * 2 + k) & 7);
+			if(!Map::IsBorder(Map::Index(px, py)))
+			{
+				x = px;
+				y = py;
+				return;
+			}
+		}
+	}
+
+	void KillPlayer(DWORD index)
+	{
+		Player* p = &player[index];
+		p->health = 0;
+		MapData remains = kSpace;
+		if(p->keys)
+		{
+			--p->keys;
+			remains = kKey;
+		}
+		map.Set(p->x, p->y, remains);
+	}
+
+	void PlaceInWorld(DWORD index, DWORD x, DWORD y)
+	{
+		Player* p = &player[index];
+		MyAssert(p->IsAlive());
+		p->x = (Coord) x;
+		p->y = (Coord) y;
+		p->dir = (Direction) (index * 2);
+		map.Set(p->x, p->y, (MapData) (kPlayer0 + index));
+		p->state = kNormal;
+		p->arrow.alive = false;
+	}
+
+	void Move(DWORD stick, Direction dir)
+	{
+		if(stick < 4 && dir < 8)
+		{
+			if(stick < numPlayers)
+			{
+				Player* p = &player[stick];
+				p->dir = dir;
+				if(p->IsVisible() && tick - p->lastMoveTick >= kTicksPerMove)
+				{
+					p->lastMoveTick = tick;
+					DWORD from = Map::Index(p->x, p->y);
+					DWORD to = from + Map::Step(dir);
+					MapData d = map.GetIndex(to);
+					if constexpr(Rules::kWallSliding)
+					{
+						// See if we can slide along the wall
+						if(d == kWall && IsDiagonal(dir))
+						{
+							for(int slideAngle = -1; slideAngle <= 1; slideAngle += 2)
+							{
+								Direction slideDir = RotateBy(dir, slideAngle);
+								MapData d2 = map.GetIndex(from + Map::Step(slideDir));
+								if(IsSlidable(d2))
+								{
+									dir = slideDir;
+									to = from + Map::Step(dir);
+									d = d2;
+									break;
+								}
+							}
+						}
+					}
+					const TileTraits& traits = TraitsOf(d);
+					bool bMove = (traits.flags & kTileWalkable) != 0;
+					if(bMove)
+					{
+						// Whatever was there is collected
+						p->keys += traits.keys;
+						p->food += traits.food;
+						p->bombs += traits.bombs;
+						p->score += traits.score;
+					}
+					else if(d == kLock)
+					{
+						if(p->keys)
+						{
+							--p->keys;
+							map.OpenLockIndex(to);
+							bMove = true;
+						}
+					}
+					else if(d == kDown)
+					{
+						p->state = kInWarp;
+						map.SetIndex(from, kSpace);
+						if(IsPartyInWarp())
+						{
+							ChangeLevel(1);
+						}
+					}
+					if(bMove)
+					{
+						map.SetIndex(from, kSpace);
+						map.SetIndex(to, (BYTE) (kPlayer0 + stick));
+						p->x = (Coord) (p->x + kDirOffsets[dir][0]);
+						p->y = (Coord) (p->y + kDirOffsets[dir][1]);
+					}
+				}
+
+			}
+		}
+		else
+		{
+			MyDebugBreak();
+		}
+	}
+
+	bool IsPartyInWarp()
+	{
+		// At least one player in warp, and no players visible
+		bool atLeastOneWarp = false;
+		bool atLeastOneVisible = false;
+		for(DWORD i = 0; i < numPlayers;i++)
+		{
+			if(player[i].IsVisible())
+			{
+				atLeastOneVisible = true;
+				break;
+			}
+			if(player[i].IsAlive() && player[i].state == kInWarp)
+			{
+				atLeastOneWarp = true;
+			}
+		}
+		if(atLeastOneWarp && ! atLeastOneVisible)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	void EatFood(DWORD index)
+	{
+		if(index < numPlayers)
+		{
+			Player* p = &player[index];
+			if(p->IsVisible())
+			{
+				p->EatFood(Rules::kHealthMax);
+			}
+		}
+	}
+
+	void Fire(DWORD index)
+	{
+		if(index < numPlayers)
+		{
+			Player* p = &player[index];
+			if(!p->arrow.alive)
+			{
+				p->arrow.alive = true;
+				p->arrow.x = p->x;
+				p->arrow.y = p->y;
+				p->arrow.dir = p->dir;
+				DoArrowMove(p, true);
+			}
+		}
+		else
+		{
+			MyDebugBreak();
+		}
+	}
+
+	void DoArrowMove(Player* p, bool isFirstMove)
+	{
+		if(!p->arrow.alive)
+		{
+			return;
+		}
+		DWORD from = Map::Index(p->arrow.x, p->arrow.y);
+		if(!isFirstMove)
+		{
+			map.SetIndex(from, kSpace);
+		}
+		DWORD to = from + Map::Step(p->arrow.dir);
+		Coord x = (Coord) (p->arrow.x + kDirOffsets[p->arrow.dir][0]);
+		Coord y = (Coord) (p->arrow.y + kDirOffsets[p->arrow.dir][1]);
+		if constexpr(Rules::kArrowsStayInView)
+		{
+			if(x < startX || y < startY || x >= endX || y >= endY)
+			{
+				p->arrow.alive = false;
+				return;
+			}
+		}
+		MapData d = map.GetIndex(to);
+		if(Arrow::CanHit(d))
+		{
+			switch(d)
+			{
+			case kBomb:
+				DoSmartBomb();
+				map.SetIndex(to, kSpace);
+				break;
+			case kGhost:
+			case kSmiley:
+			case kBig:
+			case kGen1:
+			case kGen2:
+			case kGen3:
+				map.SetIndex(to, Rules::kArrowsWeaken ? TraitsOf(d).weakened : (BYTE) kSpace);
+				break;
+			case kHeart:
+				{
+					bool foundPlayer = false;
+					for(DWORD i = 0; i < numPlayers; i++)
+					{
+						Player* p = &player[i];
+						if(!p->IsAlive())
+						{
+							p->health = 9;
+							p->state = kNormal;
+							PlaceInWorld(i, x, y);
+							foundPlayer = true;
+							break;
+						}
+					}
+					if(!foundPlayer)
+					{
+						map.SetIndex(to, kBig);
+					}
+				}
+				break;
+			default:
+				MyDebugBreak();
+			}
+			p->arrow.alive = false;
+		}
+		else if(Arrow::CanGo(d))
+		{
+			p->arrow.x = x;
+			p->arrow.y = y;
+			int rotatedDir = ((p->arrow.dir + 3) & 7); // Because font is screwed up
+			map.SetIndex(to, (BYTE) (kArrow0 + rotatedDir));
+		}
+		else
+		{
+			p->arrow.alive = false;
+		}
+	}
+
+	void UseSmartBomb(DWORD index)
+	{
+		if(index < numPlayers)
+		{
+			Player* p = &player[index];
+			if(p->bombs)
+			{
+				--p->bombs;
+				DoSmartBomb();
+			}
+		}
+		else
+		{
+			MyDebugBreak();
+		}
+	}
+
+	void DoSmartBomb()
+	{
+		float cogX;
+		float cogY;
+		DWORD startX;
+		DWORD endX;
+		DWORD startY;
+		DWORD endY;
+		GetCOG(cogX, cogY);
+		map.GetActive(cogX, cogY, startX, startY, endX, endY);
+		if(map.bitboardsEnabled)
+		{
+			// Same rectangle as the scan below, first row included.
+			map.bitboards.ForEachInRect(
+				Map::CellBitboards::PlaneMask(kPlaneMonster) | Map::CellBitboards::PlaneMask(kPlaneGenerator),
+				startX, startX, endX, endY,
+				[this](DWORD index) { map.SetIndex(index, kSpace); });
+			return;
+		}
+		for(DWORD y = startX; y < endY; y++)
+		{
+			for(DWORD x = startX; x < endX; x++)
+			{
+				MapData d = map.Get(x, y);
+				if(HasTrait(d, kTileEntity))
+				{
+					map.Set(x, y, kSpace);
+				}
+			}
+		}
+	}
+
+	// Saves the game state; costs the rows of the map written since the
+	// last Save or Restore. Returns the number of rows copied.
+	DWORD Save(Snapshot& snapshot)
+	{
+		for(DWORD i = 0; i < PlayerCount; i++)
+		{
+			snapshot.player[i] = player[i];
+		}
+		snapshot.level = level;
+		snapshot.numPlayers = numPlayers;
+		snapshot.tick = tick;
+		snapshot.rng = rng;
+		snapshot.startX = startX;
+		snapshot.startY = startY;
+		snapshot.endX = endX;
+		snapshot.endY = endY;
+		return map.Save(snapshot.map);
+	}
+
+	// Puts back a saved state. A snapshot can be restored into any world
+	// with the same rules, which forks the game; the world keeps its own
+	// pathing and thread pool settings.
+	void Restore(const Snapshot& snapshot)
+	{
+		map.Restore(snapshot.map);
+		for(DWORD i = 0; i < PlayerCount; i++)
+		{
+			player[i] = snapshot.player[i];
+		}
+		level = snapshot.level;
+		numPlayers = snapshot.numPlayers;
+		tick = snapshot.tick;
+		rng = snapshot.rng;
+		startX = snapshot.startX;
+		startY = snapshot.startY;
+		endX = snapshot.endX;
+		endY = snapshot.endY;
+	}
+
+	// The same state as a Snapshot, as kStateSize bytes that do not depend
+	// on the host, for files that embed whole worlds (replay keyframes).
+	// Coordinates are single bytes, and on large maps their high bytes
+	// follow each player's fields and the region's.
+	void WriteState(BYTE* out) const
+	{
+		memcpy(out, map.Cell, Map::NumCells);
+		BYTE* p = out + Map::NumCells;
+		for(DWORD i = 0; i < PlayerCount; i++, p += kPlayerStateSize)
+		{
+			const Player& pl = player[i];
+			p[0] = (BYTE) pl.x;
+			p[1] = (BYTE) pl.y;
+			p[2] = pl.health;
+			p[3] = pl.food;
+			p[4] = pl.keys;
+			p[5] = pl.bombs;
+			p[6] = (BYTE) pl.state;
+			p[7] = (BYTE) pl.dir;
+			Write32(p + 8, pl.score);
+			Write32(p + 12, pl.lastMoveTick);
+			p[16] = pl.arrow.alive;
+			p[17] = (BYTE) pl.arrow.x;
+			p[18] = (BYTE) pl.arrow.y;
+			p[19] = (BYTE) pl.arrow.dir;
+			if constexpr(kCoordExtra > 0)
+			{
+				p[20] = (BYTE) (pl.x >> 8);
+				p[21] = (BYTE) (pl.y >> 8);
+				p[22] = (BYTE) (pl.arrow.x >> 8);
+				p[23] = (BYTE) (pl.arrow.y >> 8);
+			}
+		}
+		Write32(p, level);
+		Write32(p + 4, numPlayers);
+		Write32(p + 8, tick);
+		Write32(p + 12, (DWORD) rng.state);
+		Write32(p + 16, (DWORD) (rng.state >> 32));
+		p[20] = (BYTE) startX;
+		p[21] = (BYTE) startY;
+		p[22] = (BYTE) endX;
+		p[23] = (BYTE) endY;
+		if constexpr(kCoordExtra > 0)
+		{
+			p[24] = (BYTE) (startX >> 8);
+			p[25] = (BYTE) (startY >> 8);
+			p[26] = (BYTE) (endX >> 8);
+			p[27] = (BYTE) (endY >> 8);
+		}
+	}
+
+	void ReadState(const BYTE* in)
+	{
+		memcpy(map.Cell, in, Map::NumCells);
+		map.OnCellsReplaced();
+		const BYTE* p = in + Map::NumCells;
+		for(DWORD i = 0; i < PlayerCount; i++, p += kPlayerStateSize)
+		{
+			Player& pl = player[i];
+			pl.x = p[0];
+			pl.y = p[1];
+			pl.health = p[2];
+			pl.food = p[3];
+			pl.keys = p[4];
+			pl.bombs = p[5];
+			pl.state = (PlayerState) p[6];
+			pl.dir = (Direction) p[7];
+			pl.score = Read32(p + 8);
+			pl.lastMoveTick = Read32(p + 12);
+			pl.arrow.alive = p[16] != 0;
+			pl.arrow.x = p[17];
+			pl.arrow.y = p[18];
+			pl.arrow.dir = (Direction) p[19];
+			if constexpr(kCoordExtra > 0)
+			{
+				pl.x = (Coord) (pl.x | p[20] << 8);
+				pl.y = (Coord) (pl.y | p[21] << 8);
+				pl.arrow.x = (Coord) (pl.arrow.x | p[22] << 8);
+				pl.arrow.y = (Coord) (pl.arrow.y | p[23] << 8);
+			}
+		}
+		level = Read32(p);
+		numPlayers = Read32(p + 4);
+		tick = Read32(p + 8);
+		rng.state = Read32(p + 12) | ((uint64_t) Read32(p + 16) << 32);
+		startX = p[20];
+		startY = p[21];
+		endX = p[22];
+		endY = p[23];
+		if constexpr(kCoordExtra > 0)
+		{
+			startX |= p[24] << 8;
+			startY |= p[25] << 8;
+			endX |= p[26] << 8;
+			endY |= p[27] << 8;
+		}
+	}
+
+	// Whether ReadState can take in: every value it indexes with is in
+	// range. For states from files, which may be corrupt.
+	static bool IsValidState(const BYTE* in)
+	{
+		for(DWORD i = 0; i < Map::NumCells; i++)
+		{
+			if(in[i] >= kNumMapData)
+			{
+				return false;
+			}
+		}
+		const BYTE* p = in + Map::NumCells;
+		for(DWORD i = 0; i < PlayerCount; i++, p += kPlayerStateSize)
+		{
+			DWORD x = p[0];
+			DWORD y = p[1];
+			DWORD arrowX = p[17];
+			DWORD arrowY = p[18];
+			if constexpr(kCoordExtra > 0)
+			{
+				x |= p[20] << 8;
+				y |= p[21] << 8;
+				arrowX |= p[22] << 8;
+				arrowY |= p[23] << 8;
+			}
+			if(x >= Map::Width || y >= Map::Height || arrowX >= Map::Width || arrowY >= Map::Height
+				|| p[6] > kNotInGame || (p[7] > kDirUpLeft && p[7] != kDirNone)
+				|| (p[19] > kDirUpLeft && p[19] != kDirNone))
+			{
+				return false;
+			}
+		}
+		DWORD startX = p[20];
+		DWORD startY = p[21];
+		DWORD endX = p[22];
+		DWORD endY = p[23];
+		if constexpr(kCoordExtra > 0)
+		{
+			startX |= p[24] << 8;
+			startY |= p[25] << 8;
+			endX |= p[26] << 8;
+			endY |= p[27] << 8;
+		}
+		// The region's end is one past its last cell.
+		return Read32(p) < Map::LevelCount() && Read32(p + 4) <= (DWORD) PlayerCount
+			&& startX <= endX && endX <= Map::Width && startY <= endY && endY <= Map::Height;
+	}
+
+	// FNV-1a over everything that defines the game state. Two worlds that
+	// were given the same seed and inputs must report the same value.
+	uint64_t Checksum() const
+	{
+		uint64_t h = 14695981039346656037ULL;
+		HashBytes(h, map.Cell, sizeof(map.Cell));
+		for(DWORD i = 0; i < numPlayers; i++)
+		{
+			const Player* p = &player[i];
+			BYTE fields[] = { (BYTE) p->x, (BYTE) p->y, p->health, p->food, p->keys, p->bombs,
+				(BYTE) p->state, (BYTE) p->dir, (BYTE) p->arrow.alive, (BYTE) p->arrow.x, (BYTE) p->arrow.y,
+				(BYTE) p->arrow.dir };
+			HashBytes(h, fields, sizeof(fields));
+			if constexpr(kCoordExtra > 0)
+			{
+				BYTE high[] = { (BYTE) (p->x >> 8), (BYTE) (p->y >> 8), (BYTE) (p->arrow.x >> 8), (BYTE) (p->arrow.y >> 8) };
+				HashBytes(h, high, sizeof(high));
+			}
+			HashBytes(h, &p->score, sizeof(p->score));
+			HashBytes(h, &p->lastMoveTick, sizeof(p->lastMoveTick));
+		}
+		HashBytes(h, &level, sizeof(level));
+		HashBytes(h, &tick, sizeof(tick));
+		HashBytes(h, &rng.state, sizeof(rng.state));
+		return h;
+	}
+
+	// Zobrist hash of the same state as Checksum. The map's part is kept up
+	// to date as cells are written, so this costs the same on any map; the
+	// players and the rest are a few words, hashed on each call.
+	uint64_t Hash() const
+	{
+#if DANDY_VERIFY_HASH
+		MyAssert(map.VerifyHash());
+#endif
+		uint64_t h = map.hash;
+		for(DWORD i = 0; i < numPlayers; i++)
+		{
+			const Player* p = &player[i];
+			uint64_t body = (BYTE) p->x | (BYTE) p->y << 8 | p->health << 16 | (DWORD) p->food << 24
+				| (uint64_t) p->keys << 32 | (uint64_t) p->bombs << 40
+				| (uint64_t) (BYTE) p->state << 48 | (uint64_t) (BYTE) p->dir << 56;
+			uint64_t counters = p->score | (uint64_t) p->lastMoveTick << 32;
+			DWORD arrow = (BYTE) p->arrow.alive | (BYTE) p->arrow.x << 8 | (BYTE) p->arrow.y << 16 | (DWORD) (BYTE) p->arrow.dir << 24;
+			h ^= Zobrist::Field(kHashPlayer + i * 3, body);
+			h ^= Zobrist::Field(kHashPlayer + i * 3 + 1, counters);
+			h ^= Zobrist::Field(kHashPlayer + i * 3 + 2, arrow);
+			if constexpr(kCoordExtra > 0)
+			{
+				DWORD high = (DWORD) (p->x >> 8) | (DWORD) (p->y >> 8) << 8
+					| (DWORD) (p->arrow.x >> 8) << 16 | (DWORD) (p->arrow.y >> 8) << 24;
+				h ^= Zobrist::Field(kHashCoordHigh + i, high);
+			}
+		}
+		h ^= Zobrist::Field(kHashLevel, level);
+		h ^= Zobrist::Field(kHashTick, tick);
+		h ^= Zobrist::Field(kHashRandom, rng.state);
+		return h;
+	}
+
+	static void HashBytes(uint64_t& h, const void* data, size_t size)
+	{
+		const BYTE* pB = (const BYTE*) data;
+		for(size_t i = 0; i < size; i++)
+		{
+			h = (h ^ pB[i]) * 1099511628211ULL;
+		}
+	}
+
+	static void MoveCoords(Coord& x, Coord& y, DWORD direction)
+	{
+		if(direction < 8)
+		{
+			x += kDirOffsets[direction][0];
+			y += kDirOffsets[direction][1];
+		}
+		else
+		{
+			MyDebugBreak();
+		}
+	}
+
+	Map map;
+	DWORD level;
+	const static int PlayerCount = 4;
+	// High bytes of each coordinate in a saved state, none on classic maps.
+	static_assert(sizeof(Coord) <= 2, "coordinates are one or two bytes");
+	const static DWORD kCoordExtra = sizeof(Coord) - 1;
+	const static DWORD kPlayerStateSize = 20 + 4 * kCoordExtra;
+	const static DWORD kStateSize = Map::NumCells + PlayerCount * kPlayerStateSize + 24 + 4 * kCoordExtra;
+
+	// Zobrist::Field ids for Hash.
+	enum
+	{
+		kHashLevel,
+		kHashTick,
+		kHashRandom,
+		kHashPlayer,	// Three per player
+		kHashCoordHigh = kHashPlayer + 3 * PlayerCount	// One per player, large maps only
+	};
+
+	// Everything the game rules read between ticks. The map part shares
+	// unchanged rows with earlier snapshots (see MapSnapshot).
+	struct Snapshot
+	{
+		typename Map::Snapshot map;
+		Player player[PlayerCount];
+		DWORD level;
+		DWORD numPlayers;
+		DWORD tick;
+		Random rng;
+		DWORD startX;
+		DWORD startY;
+		DWORD endX;
+		DWORD endY;
+	};
+
+	Player player[PlayerCount];
+	DWORD numPlayers;
+	DWORD tick;
+	Random rng;
+
+	// Players the monsters are chasing during the current DoMonsters pass.
+	Coord targetX[PlayerCount];
+	Coord targetY[PlayerCount];
+	DWORD numTargets;
+
+	// Active region for the current tick (UpdateActiveRegion).
+	DWORD startX;
+	DWORD startY;
+	DWORD endX;
+	DWORD endY;
+
+	// Scratch space for DoMonsters, kept between ticks to avoid allocating.
+	std::vector<EntityIndex> activeEntities;
+	std::vector<Stripe> stripes;
+	std::vector<std::vector<CellChange> > stripeLogs;
+
+	MonsterPathing pathing;
+	FlowField<Map::ViewWidth + 1, Map::ViewHeight + 1, Coord> flowField;
+
+	ThreadPool* monsterPool;
+	static const DWORD kMinParallelStripes = 2;
+
+	static const DWORD kTicksPerMove = 3;
+};
+
+typedef WorldT<ClassicRules> World;
+typedef WorldT<Xbox360Rules> World360;
+
+// The largest map, for stress runs with hot-joining players. Its cells
+// alone are 16 MB, so allocate it on the heap.
+typedef WorldT<Xbox360Rules, LargeGeometry<4096, 4096> > WorldLarge;
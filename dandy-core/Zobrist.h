@@ -0,0 +1,46 @@
+#pragma once
+
+#include "DandyTypes.h"
+#include "MapData.h"
+#include "Random.h"
+
+// Zobrist keys for hashing game state: the hash of a state is the XOR of
+// one 64-bit key per (place, value) in it, so changing one value updates
+// the hash with two XORs. Keys come from SplitMix64 rather than a table;
+// a table of every cell and kind would be 400 KB, and a key costs a few
+// multiplies.
+//
+// Builds with DANDY_VERIFY_HASH set to 1 recompute the hash from scratch
+// after every World tick and assert that the incremental one matches.
+#ifndef DANDY_VERIFY_HASH
+#define DANDY_VERIFY_HASH 0
+#endif
+
+struct Zobrist
+{
+	// An empty cell has key 0, so a hash only pays for what is on the map.
+	static uint64_t Cell(DWORD index, BYTE v)
+	{
+		return v == kSpace ? 0 : Random::Mix(((uint64_t) index << 8 | v) ^ kCellSalt);
+	}
+
+	static uint64_t Cells(const BYTE* cells, DWORD count)
+	{
+		uint64_t h = 0;
+		for(DWORD i = 0; i < count; i++)
+		{
+			h ^= Cell(i, cells[i]);
+		}
+		return h;
+	}
+
+	// A value of some other kind of state; each place (a player's field, the
+	// tick, ...) has its own id.
+	static uint64_t Field(DWORD id, uint64_t v)
+	{
+		return Random::Mix(v ^ Random::Mix(id ^ kFieldSalt));
+	}
+
+	static const uint64_t kCellSalt = 0x5a0b7157ce11ULL;
+	static const uint64_t kFieldSalt = 0xf1e1d5a17ULL;
+};
@@ -0,0 +1,82 @@
+// dandy-batch: steps many games at once on a work-stealing thread pool and
+// reports aggregate throughput. The checksum printed at the end depends only
+// on the seeds, not on --threads.
+
+#include "../BatchSim.h"
+#include "RandomPad.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void Usage()
+{
+	fprintf(stderr,
+		"usage: dandy-batch [--games N] [--threads N] [--ticks N] [--seed N] [--levels DIR]\n");
+}
+
+int main(int argc, char** argv)
+{
+	DWORD numGames = 1024;
+	DWORD numThreads = 0;
+	DWORD ticks = 10000;
+	uint64_t seed = 1;
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--games") && i + 1 < argc)
+		{
+			numGames = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--threads") && i + 1 < argc)
+		{
+			numThreads = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--ticks") && i + 1 < argc)
+		{
+			ticks = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--seed") && i + 1 < argc)
+		{
+			seed = strtoull(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--levels") && i + 1 < argc)
+		{
+			Map::SetLevelDirectory(argv[++i]);
+		}
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	Map::PreloadLevels();
+
+	// --threads counts every thread doing work, including this one; 0 (the
+	// default) is one per core.
+	ThreadPool pool(numThreads > 0 ? numThreads - 1 : kThreadPoolAuto);
+	BatchSim sim(numGames, seed, &pool);
+
+	std::vector<RandomPad> pads(numGames * World::PlayerCount);
+	for(DWORD i = 0; i < pads.size(); i++)
+	{
+		pads[i].Seed(BatchSim::GameSeed(seed ^ 0x5eed, i));
+	}
+	std::vector<BYTE> buttons(pads.size());
+
+	for(DWORD t = 0; t < ticks; t++)
+	{
+		for(DWORD i = 0; i < pads.size(); i++)
+		{
+			buttons[i] = pads[i].Next();
+		}
+		sim.Step(&buttons[0]);
+	}
+
+	printf("games       %u\n", numGames);
+	printf("threads     %u\n", pool.NumThreads() + 1);
+	printf("ticks       %llu\n", (unsigned long long) sim.TotalTicks());
+	printf("seconds     %.3f\n", sim.ElapsedSeconds());
+	printf("ticks/sec   %.0f\n", sim.TicksPerSecond());
+	printf("checksum    %016llx\n", (unsigned long long) sim.Checksum());
+	return 0;
+}
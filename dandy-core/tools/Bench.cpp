@@ -0,0 +1,112 @@
+// dandy-bench: micro and macro benchmarks for the core. Run with no
+// arguments to list them, or name one or more to run.
+
+#include "Bench.h"
+#include "../Map.h"
+
+#include <stdio.h>
+#include <string.h>
+
+struct BenchEntry
+{
+	const char* name;
+	BenchFunc func;
+	const char* description;
+};
+
+static const BenchEntry kBenches[] =
+{
+	{ "pathing", BenchPathing, "direct vs flow-field monster pathing on every shipped level" },
+	{ "bitboards", BenchBitboards, "bulk map queries by scan vs bitboards, and their upkeep" },
+	{ "levelload", BenchLevelLoad, "level change stall: level file vs preloaded level cache" },
+	{ "unpack", BenchUnpack, "level nibble unpacking: scalar vs SSE2 vs AVX2, single and batch" },
+	{ "archive", BenchArchive, "mapped level archive vs one file per level" },
+	{ "rules", BenchRules, "whole-game ticks/sec of the classic and Xbox 360 rules" },
+	{ "traits", BenchTraits, "cell classification: range tests and switches vs the tile trait table" },
+	{ "snapshot", BenchSnapshot, "forking games by copy-on-write snapshot vs copying the Game" },
+	{ "rollback", BenchRollback, "frame time of a rollback peer that re-simulates every frame" },
+	{ "hash", BenchHash, "incremental Zobrist World hash vs recomputing it and the checksum" },
+	{ "env", BenchEnv, "env-steps/sec of the batched RL environment (Env.h)" },
+	{ "planes", BenchPlanes, "one-hot feature planes of maps and views: scalar vs SSE2 vs AVX2" },
+	{ "rays", BenchRays, "player ray sensors: ray tables vs stepping the grid, and table upkeep" },
+	{ "locks", BenchLocks, "opening doors: recursive fill vs scanline fill vs labelled lock lists" },
+	{ "find", BenchFind, "Map::Find and cell counts: scanning vs the cell index" },
+	{ "large", BenchLarge, "level loads and ticks/sec on the classic map and on large tiled maps" },
+};
+
+static const DWORD kNumBenches = sizeof(kBenches) / sizeof(kBenches[0]);
+
+static void Usage()
+{
+	fprintf(stderr, "usage: dandy-bench [--ticks N] [--iterations N] [--seed N] [--levels DIR] all|NAME...\n\n");
+	for(DWORD i = 0; i < kNumBenches; i++)
+	{
+		fprintf(stderr, "  %-12s %s\n", kBenches[i].name, kBenches[i].description);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	options.ticks = 20000;
+	options.iterations = 100000;
+	options.seed = 1;
+	const char* names[64];
+	DWORD numNames = 0;
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--ticks") && i + 1 < argc)
+		{
+			options.ticks = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--iterations") && i + 1 < argc)
+		{
+			options.iterations = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--seed") && i + 1 < argc)
+		{
+			options.seed = strtoull(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--levels") && i + 1 < argc)
+		{
+			Map::SetLevelDirectory(argv[++i]);
+		}
+		else if(argv[i][0] != '-' && numNames < 64)
+		{
+			names[numNames++] = argv[i];
+		}
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+	if(numNames == 0)
+	{
+		Usage();
+		return 1;
+	}
+
+	Map::PreloadLevels();
+
+	int result = 0;
+	for(DWORD n = 0; n < numNames; n++)
+	{
+		bool found = false;
+		for(DWORD i = 0; i < kNumBenches; i++)
+		{
+			if(!strcmp(names[n], "all") || !strcmp(names[n], kBenches[i].name))
+			{
+				printf("== %s\n", kBenches[i].name);
+				result |= kBenches[i].func(options);
+				found = true;
+			}
+		}
+		if(!found)
+		{
+			fprintf(stderr, "unknown benchmark '%s'\n", names[n]);
+			return 1;
+		}
+	}
+	return result;
+}
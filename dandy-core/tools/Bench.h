@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../DandyTypes.h"
+
+#include <chrono>
+
+struct BenchOptions
+{
+	DWORD ticks;
+	DWORD iterations;
+	uint64_t seed;
+};
+
+typedef int (*BenchFunc)(const BenchOptions& options);
+
+// Each benchmark lives in its own Bench*.cpp and is listed in Bench.cpp.
+int BenchPathing(const BenchOptions& options);
+int BenchBitboards(const BenchOptions& options);
+int BenchLevelLoad(const BenchOptions& options);
+int BenchUnpack(const BenchOptions& options);
+int BenchArchive(const BenchOptions& options);
+int BenchRules(const BenchOptions& options);
+int BenchTraits(const BenchOptions& options);
+int BenchSnapshot(const BenchOptions& options);
+int BenchRollback(const BenchOptions& options);
+int BenchHash(const BenchOptions& options);
+int BenchEnv(const BenchOptions& options);
+int BenchPlanes(const BenchOptions& options);
+int BenchRays(const BenchOptions& options);
+int BenchLocks(const BenchOptions& options);
+int BenchFind(const BenchOptions& options);
+int BenchLarge(const BenchOptions& options);
+
+class BenchTimer
+{
+public:
+	BenchTimer()
+	{
+		start = std::chrono::steady_clock::now();
+	}
+
+	double Seconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,90 @@
+#include "Bench.h"
+#include "../LevelArchive.h"
+#include "../Map.h"
+#include "../Random.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// A large level corpus as one mapped archive, against one file per level:
+// opening it, and loading levels from it in random order.
+
+int BenchArchive(const BenchOptions& options)
+{
+	const DWORD kCorpus = 20000;
+	std::vector<BYTE> shipped(Map::NumLevels * Map::PackedLevelSize);
+	for(DWORD i = 0; i < Map::NumLevels; i++)
+	{
+		FILE* in = Map::OpenLevelFile(i);
+		if(!in || fread(&shipped[i * Map::PackedLevelSize], 1, Map::PackedLevelSize, in) != Map::PackedLevelSize)
+		{
+			fprintf(stderr, "level %c: cannot read\n", 'a' + i);
+			return 1;
+		}
+		fclose(in);
+	}
+	std::vector<BYTE> corpus(kCorpus * Map::PackedLevelSize);
+	for(DWORD i = 0; i < kCorpus; i++)
+	{
+		memcpy(&corpus[i * Map::PackedLevelSize], &shipped[(i % Map::NumLevels) * Map::PackedLevelSize], Map::PackedLevelSize);
+	}
+
+	const char* tmp = getenv("TMPDIR");
+	std::string path = std::string(tmp ? tmp : "/tmp") + "/dandy-bench.dlva";
+	BenchTimer write;
+	if(!LevelArchive::Write(path.c_str(), &corpus[0], NULL, kCorpus))
+	{
+		fprintf(stderr, "%s: cannot write\n", path.c_str());
+		return 1;
+	}
+	double writeSeconds = write.Seconds();
+
+	LevelArchive archive;
+	BenchTimer open;
+	bool opened = archive.Open(path.c_str());
+	double openSeconds = open.Seconds();
+	remove(path.c_str());
+	if(!opened || archive.Count() != kCorpus)
+	{
+		fprintf(stderr, "%s: cannot open\n", path.c_str());
+		return 1;
+	}
+
+	int result = 0;
+	static Map map;
+	for(DWORD i = 0; i < Map::NumLevels; i++)
+	{
+		map.LoadLevel(archive, i + Map::NumLevels);
+		if(memcmp(map.Cell, Map::GetLevelCells(i), Map::NumCells))
+		{
+			fprintf(stderr, "level %c: archive differs from the file\n", 'a' + i);
+			result = 1;
+		}
+	}
+
+	Random pick(options.seed);
+	BenchTimer mapped;
+	for(DWORD i = 0; i < options.iterations; i++)
+	{
+		map.LoadLevel(archive, pick.Get(kCorpus));
+	}
+	double mappedUs = mapped.Seconds() * 1e6 / options.iterations;
+
+	static BYTE cells[Map::NumCells];
+	DWORD fileLoads = std::max<DWORD>(1, options.iterations / 10);
+	BenchTimer files;
+	for(DWORD i = 0; i < fileLoads; i++)
+	{
+		Map::ReadLevelFile(pick.Get(Map::NumLevels), cells);
+	}
+	double filesUs = files.Seconds() * 1e6 / fileLoads;
+
+	printf("%u levels: write %.1f ms, open and check %.1f ms\n", kCorpus, writeSeconds * 1e3, openSeconds * 1e3);
+	printf("%-24s %8.2f us\n", "LoadLevel from archive", mappedUs);
+	printf("%-24s %8.2f us\n", "read one level file", filesUs);
+	return result;
+}
@@ -0,0 +1,154 @@
+#include "Bench.h"
+#include "../World.h"
+
+#include <stdio.h>
+
+// Bulk queries on every shipped level, answered by scanning Cell and by
+// the bitboards, plus what keeping the bitboards in step costs a running
+// world. Every query is checked to give the same answer both ways.
+
+static DWORD ScanCount(const Map& map, DWORD left, DWORD top, DWORD right, DWORD bottom)
+{
+	DWORD count = 0;
+	for(DWORD y = top; y < bottom; y++)
+	{
+		for(DWORD x = left; x < right; x++)
+		{
+			BYTE d = map.Cell[x + y * Map::Width];
+			count += (d >= kGhost && d <= kBig) || (d >= kGen1 && d <= kGen3);
+		}
+	}
+	return count;
+}
+
+// Map::Find reads the cell index, so both sides of Find(kUp) are done here.
+static bool ScanFind(const Map& map, BYTE v, DWORD& index)
+{
+	for(DWORD i = 0; i < Map::NumCells; i++)
+	{
+		if(map.Cell[i] == v)
+		{
+			index = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static DWORD BoardCount(const Map& map, DWORD left, DWORD top, DWORD right, DWORD bottom)
+{
+	DWORD count = 0;
+	map.bitboards.ForEachInRect(
+		Map::CellBitboards::PlaneMask(kPlaneMonster) | Map::CellBitboards::PlaneMask(kPlaneGenerator),
+		left, top, right, bottom, [&count](DWORD) { count++; });
+	return count;
+}
+
+static double WorldTicksPerSecond(bool bitboards, const BenchOptions& options)
+{
+	static World world;
+	BenchTimer timer;
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		world.Seed(options.seed + level);
+		world.Init();
+		world.map.EnableBitboards(bitboards);
+		world.LoadLevel(level);
+		for(DWORD t = 0; t < options.ticks; t++)
+		{
+			world.Update();
+			if(world.IsGameOver())
+			{
+				world.Init();
+				world.LoadLevel(level);
+			}
+		}
+	}
+	return options.ticks * (double) Map::NumLevels / timer.Seconds();
+}
+
+int BenchBitboards(const BenchOptions& options)
+{
+	static Map map;
+	double scanFind = 0;
+	double boardFind = 0;
+	double scanRect = 0;
+	double boardRect = 0;
+	double scanCount = 0;
+	double boardCount = 0;
+	DWORD sink = 0;
+	int result = 0;
+
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		map.EnableBitboards(false);
+		map.LoadLevel(level);
+		DWORD up = 0;
+		bool found = ScanFind(map, kUp, up);
+		DWORD total = ScanCount(map, 0, 0, Map::Width, Map::Height);
+		DWORD view = ScanCount(map, 20, 10, 41, 21);
+
+		BenchTimer t0;
+		for(DWORD i = 0; i < options.iterations; i++)
+		{
+			DWORD index;
+			sink += ScanFind(map, kUp, index) ? index : 0;
+		}
+		scanFind += t0.Seconds();
+		BenchTimer t1;
+		for(DWORD i = 0; i < options.iterations; i++)
+		{
+			sink += ScanCount(map, 20, 10, 41, 21);
+		}
+		scanRect += t1.Seconds();
+		BenchTimer t2;
+		for(DWORD i = 0; i < options.iterations; i++)
+		{
+			sink += ScanCount(map, 0, 0, Map::Width, Map::Height);
+		}
+		scanCount += t2.Seconds();
+
+		map.EnableBitboards(true);
+		DWORD index = 0;
+		if(map.bitboards.FindFirst(map.Cell, kUp, index) != found || (found && index != up)
+			|| BoardCount(map, 20, 10, 41, 21) != view
+			|| map.bitboards.CountInRect(Map::CellBitboards::PlaneMask(kPlaneMonster)
+				| Map::CellBitboards::PlaneMask(kPlaneGenerator), 0, 0, Map::Width, Map::Height) != total)
+		{
+			fprintf(stderr, "level %c: bitboards disagree with the scan\n", 'a' + level);
+			result = 1;
+		}
+
+		BenchTimer t3;
+		for(DWORD i = 0; i < options.iterations; i++)
+		{
+			sink += map.bitboards.FindFirst(map.Cell, kUp, index) ? index : 0;
+		}
+		boardFind += t3.Seconds();
+		BenchTimer t4;
+		for(DWORD i = 0; i < options.iterations; i++)
+		{
+			sink += BoardCount(map, 20, 10, 41, 21);
+		}
+		boardRect += t4.Seconds();
+		BenchTimer t5;
+		for(DWORD i = 0; i < options.iterations; i++)
+		{
+			sink += map.bitboards.CountInRect(Map::CellBitboards::PlaneMask(kPlaneMonster)
+				| Map::CellBitboards::PlaneMask(kPlaneGenerator), 0, 0, Map::Width, Map::Height);
+		}
+		boardCount += t5.Seconds();
+	}
+
+	double calls = options.iterations * (double) Map::NumLevels / 1e9;
+	printf("%-28s %10s %10s\n", "ns/query", "scan", "bitboard");
+	printf("%-28s %10.1f %10.1f\n", "Find(kUp)", scanFind / calls, boardFind / calls);
+	printf("%-28s %10.1f %10.1f\n", "visit monsters in view", scanRect / calls, boardRect / calls);
+	printf("%-28s %10.1f %10.1f\n", "count monsters on map", scanCount / calls, boardCount / calls);
+
+	double off = WorldTicksPerSecond(false, options);
+	double on = WorldTicksPerSecond(true, options);
+	printf("\n%-28s %10.0f %10.0f\n", "world ticks/sec", off, on);
+	printf("(sink %u)\n", sink & 1);
+	return result;
+}
@@ -0,0 +1,75 @@
+#include "Bench.h"
+#include "../Env.h"
+#include "../Map.h"
+#include "../Player.h"
+#include "../Random.h"
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+// The batched environment at a few batch sizes, driven with random
+// actions drawn ahead of time so only DandyEnvStep is timed. Reports
+// env-steps/sec on all cores and per core.
+
+static const DWORD kActionSets = 64;
+
+int BenchEnv(const BenchOptions& options)
+{
+	static const DWORD kBatches[] = { 16, 256, 4096 };
+	DWORD cores = std::max(1u, std::thread::hardware_concurrency());
+	int result = 0;
+	for(DWORD b = 0; b < sizeof(kBatches) / sizeof(kBatches[0]); b++)
+	{
+		DandyEnvConfig config;
+		DandyEnvDefaultConfig(&config);
+		config.numEnvs = kBatches[b];
+		config.seed = options.seed;
+		DandyEnv* env = DandyEnvCreate(&config);
+		std::vector<uint8_t> observations((size_t) config.numEnvs * DANDY_ENV_OBSERVATION_SIZE);
+		std::vector<float> rewards(config.numEnvs * config.numAgents);
+		std::vector<uint8_t> dones(config.numEnvs);
+		std::vector<uint8_t> actions(kActionSets * config.numEnvs * config.numAgents);
+		Random rng(options.seed);
+		for(size_t i = 0; i < actions.size(); i++)
+		{
+			actions[i] = (uint8_t) rng.Get(DANDY_ENV_NUM_ACTIONS);
+		}
+		DandyEnvSetBuffers(env, observations.data(), rewards.data(), dones.data());
+		DandyEnvReset(env);
+
+		// About options.ticks steps of a 1024-env batch in all.
+		DWORD steps = (DWORD) std::max<uint64_t>(16, (uint64_t) options.ticks * 1024 / config.numEnvs);
+		double reward = 0;
+		BenchTimer timer;
+		for(DWORD s = 0; s < steps; s++)
+		{
+			DandyEnvStep(env, &actions[(s % kActionSets) * config.numEnvs * config.numAgents]);
+		}
+		double seconds = timer.Seconds();
+
+		// Untimed: every observation starts with the map's corner wall and
+		// has the agent in it.
+		for(DWORD s = 0; s < kActionSets; s++)
+		{
+			DandyEnvStep(env, &actions[s * config.numEnvs * config.numAgents]);
+			for(DWORD i = 0; i < config.numEnvs; i++)
+			{
+				const uint8_t* o = &observations[(size_t) i * DANDY_ENV_OBSERVATION_SIZE];
+				const uint8_t* agent = o + Map::NumCells;
+				if(o[0] != kWall || (!dones[i] && agent[2] && agent[6] == kNormal && o[Map::Index(agent[0], agent[1])] != kPlayer0))
+				{
+					fprintf(stderr, "%u envs: env %u observation is wrong\n", config.numEnvs, i);
+					result = 1;
+				}
+				reward += rewards[i];
+			}
+		}
+		DandyEnvDestroy(env);
+
+		double rate = (double) steps * config.numEnvs / seconds;
+		printf("%5u envs   %12.0f steps/s  %12.0f per core  (reward/step %.4f)\n", config.numEnvs, rate, rate / cores,
+			reward / ((double) kActionSets * config.numEnvs));
+	}
+	return result;
+}
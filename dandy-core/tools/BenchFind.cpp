@@ -0,0 +1,129 @@
+#include "Bench.h"
+#include "../World.h"
+
+#include <stdio.h>
+
+// Map::Find and cell counts on every shipped level, answered by scanning
+// Cell and by the cell index, then a game played on each level with the
+// index checked against a scan for every kind of cell after every tick.
+
+static bool ScanFind(const Map& map, BYTE v, DWORD& index)
+{
+	for(DWORD i = 0; i < Map::NumCells; i++)
+	{
+		if(map.Cell[i] == v)
+		{
+			index = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static DWORD ScanCount(const Map& map, BYTE first, BYTE last)
+{
+	DWORD count = 0;
+	for(DWORD i = 0; i < Map::NumCells; i++)
+	{
+		count += map.Cell[i] >= first && map.Cell[i] <= last;
+	}
+	return count;
+}
+
+static bool CheckIndex(Map& map)
+{
+	for(DWORD v = 0; v < kNumMapData; v++)
+	{
+		DWORD scanned = 0;
+		bool found = ScanFind(map, (BYTE) v, scanned);
+		BYTE x = 0;
+		BYTE y = 0;
+		if(map.Find(x, y, (MapData) v) != found
+			|| (found && Map::Index(x, y) != scanned)
+			|| map.Count((MapData) v) != ScanCount(map, (BYTE) v, (BYTE) v))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int BenchFind(const BenchOptions& options)
+{
+	static Map map;
+	double scanFind = 0;
+	double indexFind = 0;
+	double scanCount = 0;
+	double indexCount = 0;
+	DWORD sink = 0;
+	int result = 0;
+
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		map.LoadLevel(level);
+		if(!CheckIndex(map))
+		{
+			fprintf(stderr, "level %c: the cell index disagrees with the scan\n", 'a' + level);
+			result = 1;
+		}
+
+		BenchTimer t0;
+		for(DWORD i = 0; i < options.iterations; i++)
+		{
+			DWORD index;
+			sink += ScanFind(map, kUp, index) ? index : 0;
+		}
+		scanFind += t0.Seconds();
+		BenchTimer t1;
+		for(DWORD i = 0; i < options.iterations; i++)
+		{
+			BYTE x;
+			BYTE y;
+			sink += map.Find(x, y, kUp) ? x + y : 0;
+		}
+		indexFind += t1.Seconds();
+		BenchTimer t2;
+		for(DWORD i = 0; i < options.iterations; i++)
+		{
+			sink += ScanCount(map, kGen1, kGen3);
+		}
+		scanCount += t2.Seconds();
+		BenchTimer t3;
+		for(DWORD i = 0; i < options.iterations; i++)
+		{
+			sink += map.CountRange(kGen1, kGen3);
+		}
+		indexCount += t3.Seconds();
+	}
+
+	double calls = options.iterations * (double) Map::NumLevels / 1e9;
+	printf("%-28s %10s %10s\n", "ns/query", "scan", "index");
+	printf("%-28s %10.1f %10.1f\n", "Find(kUp)", scanFind / calls, indexFind / calls);
+	printf("%-28s %10.1f %10.1f\n", "count generators", scanCount / calls, indexCount / calls);
+
+	static World world;
+	DWORD ticks = std::max<DWORD>(1, options.ticks / 10);
+	for(DWORD level = 0; level < Map::NumLevels && !result; level++)
+	{
+		world.Seed(options.seed + level);
+		world.Init();
+		world.LoadLevel(level);
+		for(DWORD t = 0; t < ticks; t++)
+		{
+			world.Update();
+			if(world.IsGameOver())
+			{
+				world.Init();
+				world.LoadLevel(level);
+			}
+			if(!CheckIndex(world.map))
+			{
+				fprintf(stderr, "level %c tick %u: the cell index disagrees with the scan\n", 'a' + level, t);
+				result = 1;
+				break;
+			}
+		}
+	}
+	printf("(sink %u)\n", sink & 1);
+	return result;
+}
@@ -0,0 +1,80 @@
+#include "Bench.h"
+#include "RandomPad.h"
+
+#include <stdio.h>
+
+// Hashing the whole World every tick on every shipped level: the
+// incremental Zobrist hash (World::Hash), the same hash recomputed over
+// every cell, and the FNV Checksum. The incremental hash must match the
+// recompute on every tick, and a game restored from a snapshot must hash
+// the same as the game it was saved from.
+
+static const DWORD kForkTicks = 60;
+
+int BenchHash(const BenchOptions& options)
+{
+	static Game game;
+	static Game forked;
+	Game::Snapshot snapshot;
+	RandomPad pads[World::PlayerCount];
+	double hashTime = 0;
+	double recomputeTime = 0;
+	double checksumTime = 0;
+	uint64_t hashes = 0;
+	uint64_t sink = 0;
+	int result = 0;
+
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		for(DWORD i = 0; i < World::PlayerCount; i++)
+		{
+			pads[i].Seed(options.seed * World::PlayerCount + i);
+		}
+		game.Start(options.seed + level);
+		game.world.LoadLevel(level);
+		for(DWORD t = 0; t < options.ticks; t++)
+		{
+			for(DWORD i = 0; i < World::PlayerCount; i++)
+			{
+				game.SetButtons(i, pads[i].Next());
+			}
+			game.Step();
+
+			BenchTimer hash;
+			uint64_t h = game.world.Hash();
+			hashTime += hash.Seconds();
+
+			BenchTimer recompute;
+			uint64_t cells = Zobrist::Cells(game.world.map.Cell, Map::NumCells);
+			recomputeTime += recompute.Seconds();
+
+			BenchTimer checksum;
+			sink += game.world.Checksum();
+			checksumTime += checksum.Seconds();
+			++hashes;
+
+			if(cells != game.world.map.hash)
+			{
+				fprintf(stderr, "level %c tick %u: incremental hash differs from recompute\n", 'a' + level, t);
+				return 1;
+			}
+			if(t % kForkTicks == 0)
+			{
+				game.Save(snapshot);
+				forked.Restore(snapshot);
+				if(forked.world.Hash() != h)
+				{
+					fprintf(stderr, "level %c tick %u: restored game hashes differently\n", 'a' + level, t);
+					result = 1;
+				}
+			}
+			sink += h;
+		}
+	}
+
+	printf("%-28s %10.1f\n", "incremental hash ns", hashTime * 1e9 / hashes);
+	printf("%-28s %10.1f\n", "recompute map hash ns", recomputeTime * 1e9 / hashes);
+	printf("%-28s %10.1f\n", "checksum ns", checksumTime * 1e9 / hashes);
+	printf("(sink %u)\n", (DWORD) (sink & 1));
+	return result;
+}
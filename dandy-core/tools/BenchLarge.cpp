@@ -0,0 +1,93 @@
+#include "Bench.h"
+#include "RandomPad.h"
+
+#include <memory>
+#include <stdio.h>
+#include <vector>
+
+// The Xbox 360 game with four hot-joined players on random pads, on the
+// classic 60x30 map and on large maps of tiled levels: how long a level
+// takes to load and how many ticks a second the game runs at. On the large
+// maps the players start in the last copy of the level, so their
+// coordinates need both bytes. After each level the world's state is
+// written out and read into another world, which must give the same
+// checksum and hash.
+
+template<class Geometry>
+static int RunSize(const char* name, const BenchOptions& options)
+{
+	typedef GameT<Xbox360Rules, Geometry> GameType;
+	typedef WorldT<Xbox360Rules, Geometry> WorldType;
+	typedef typename WorldType::Map MapType;
+	std::unique_ptr<GameType> game(new GameType);
+	std::unique_ptr<GameType> copy(new GameType);
+	std::vector<BYTE> state(WorldType::kStateSize);
+	RandomPad pads[GameType::PlayerCount];
+	double loadTime = 0;
+	double tickTime = 0;
+	uint64_t ticks = 0;
+	DWORD farthest = 0;
+	int result = 0;
+
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		game->Start(options.seed + level);
+		BenchTimer load;
+		game->world.LoadLevel(level);
+		loadTime += load.Seconds();
+		MapType& map = game->world.map;
+		typename MapType::Coord x;
+		typename MapType::Coord y;
+		while(map.Count(kUp) > 1 && map.Find(x, y, kUp))
+		{
+			map.Set(x, y, kSpace);
+		}
+		for(DWORD i = 0; i < GameType::PlayerCount; i++)
+		{
+			pads[i].Seed(options.seed * GameType::PlayerCount + i);
+			game->SetConnected(i, true);
+		}
+
+		BenchTimer tick;
+		for(DWORD t = 0; t < options.ticks; t++)
+		{
+			for(DWORD i = 0; i < GameType::PlayerCount; i++)
+			{
+				game->SetButtons(i, pads[i].Next());
+			}
+			game->Step();
+		}
+		tickTime += tick.Seconds();
+		ticks += options.ticks;
+		for(DWORD i = 0; i < GameType::PlayerCount; i++)
+		{
+			farthest = std::max<DWORD>(farthest, game->world.player[i].x + game->world.player[i].y);
+		}
+
+		game->world.WriteState(&state[0]);
+		copy->world.ReadState(&state[0]);
+		if(copy->world.Checksum() != game->world.Checksum() || copy->world.Hash() != game->world.Hash())
+		{
+			fprintf(stderr, "%s level %c: the state read back differs\n", name, 'a' + level);
+			result = 1;
+		}
+	}
+
+	char label[64];
+	snprintf(label, sizeof(label), "%s level load us", name);
+	printf("%-28s %10.1f\n", label, loadTime * 1e6 / Map::NumLevels);
+	snprintf(label, sizeof(label), "%s ticks/sec", name);
+	printf("%-28s %10.0f\n", label, ticks / tickTime);
+	snprintf(label, sizeof(label), "%s farthest x + y", name);
+	printf("%-28s %10u\n", label, farthest);
+	return result;
+}
+
+int BenchLarge(const BenchOptions& options)
+{
+	Map::PreloadLevels();
+	int result = RunSize<ClassicGeometry>("60x30", options);
+	result |= RunSize<LargeGeometry<600, 300> >("600x300", options);
+	result |= RunSize<LargeGeometry<4096, 4096> >("4096x4096", options);
+	return result;
+}
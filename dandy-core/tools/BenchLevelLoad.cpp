@@ -0,0 +1,101 @@
+#include "Bench.h"
+#include "../World.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+// The stall a level change puts on the game thread: the old path that
+// opened and decoded the level file with fgetc on every change, against a
+// copy out of the preloaded level cache.
+
+static bool LoadLevelFromFile(Map& map, DWORD index)
+{
+	FILE* in = Map::OpenLevelFile(index);
+	if(!in)
+	{
+		return false;
+	}
+	bool failed = false;
+	for(DWORD i = 0; i < Map::NumCells && !failed; i += 2)
+	{
+		int inb = fgetc(in);
+		failed = inb < 0;
+		map.Cell[i] = (BYTE) (inb & 0xf);
+		map.Cell[i + 1] = (BYTE) ((inb >> 4) & 0xf);
+	}
+	fclose(in);
+	Map::SealBorder(map.Cell);
+	map.OnCellsReplaced();
+	return !failed;
+}
+
+struct StallResult
+{
+	double mean;
+	double worst;
+};
+
+template<class F>
+static StallResult Measure(DWORD rounds, const F& load)
+{
+	StallResult result;
+	result.mean = 0;
+	result.worst = 0;
+	for(DWORD r = 0; r < rounds; r++)
+	{
+		for(DWORD level = 0; level < Map::NumLevels; level++)
+		{
+			BenchTimer timer;
+			load(level);
+			double seconds = timer.Seconds();
+			result.mean += seconds;
+			result.worst = std::max(result.worst, seconds);
+		}
+	}
+	result.mean /= rounds * Map::NumLevels;
+	return result;
+}
+
+int BenchLevelLoad(const BenchOptions& options)
+{
+	static Map map;
+	static Map reference;
+	DWORD rounds = std::max<DWORD>(1, options.iterations / 1000);
+	int result = 0;
+
+	// What PreloadLevels pays once at startup.
+	static BYTE cells[Map::NumLevels][Map::NumCells];
+	BenchTimer preload;
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		Map::ReadLevelFile(level, cells[level]);
+	}
+	double preloadSeconds = preload.Seconds();
+
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		LoadLevelFromFile(reference, level);
+		map.LoadLevel(level);
+		if(memcmp(map.Cell, reference.Cell, Map::NumCells))
+		{
+			fprintf(stderr, "level %c: cache differs from the file\n", 'a' + level);
+			result = 1;
+		}
+	}
+
+	StallResult file = Measure(rounds, [](DWORD level) { LoadLevelFromFile(map, level); });
+	StallResult cached = Measure(rounds, [](DWORD level) { map.LoadLevel(level); });
+	StallResult copy = Measure(rounds, [](DWORD level) { memcpy(map.Cell, Map::GetLevelCells(level), Map::NumCells); });
+
+	static World world;
+	world.Init();
+	StallResult change = Measure(rounds, [](DWORD level) { world.LoadLevel(level); });
+
+	printf("preload all levels  %8.1f us\n", preloadSeconds * 1e6);
+	printf("%-20s %10s %10s\n", "us/level change", "mean", "worst");
+	printf("%-20s %10.2f %10.2f\n", "file + fgetc", file.mean * 1e6, file.worst * 1e6);
+	printf("%-20s %10.2f %10.2f\n", "level cache", cached.mean * 1e6, cached.worst * 1e6);
+	printf("%-20s %10.2f %10.2f\n", "  of which memcpy", copy.mean * 1e6, copy.worst * 1e6);
+	printf("%-20s %10.2f %10.2f\n", "World::LoadLevel", change.mean * 1e6, change.worst * 1e6);
+	return result;
+}
@@ -0,0 +1,139 @@
+#include "Bench.h"
+#include "../Map.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Opening doors three ways: the recursive 8-way fill the game used to do,
+// the scanline fill Map falls back to, and clearing the cell list that
+// Map::LabelLocks found (timed with and without the labelling). Run on a
+// map that is one 58x28 door, and on every door of every shipped level.
+// Every way must leave the same cells.
+
+static void OpenLockRecursive(Map& map, DWORD index)
+{
+	static const int kFill[8] =
+	{
+		-1 - (int) Map::Width, -(int) Map::Width, 1 - (int) Map::Width,
+		-1, 1,
+		(int) Map::Width - 1, (int) Map::Width, (int) Map::Width + 1
+	};
+	if(map.Cell[index] == kLock)
+	{
+		map.SetIndex(index, kSpace);
+		for(DWORD k = 0; k < 8; k++)
+		{
+			OpenLockRecursive(map, index + kFill[k]);
+		}
+	}
+}
+
+enum OpenWay
+{
+	kRecursive,
+	kScanline,
+	kLabelAndOpen,
+	kLabelled,
+	kNumWays
+};
+
+static const char* const kWayNames[kNumWays] = { "recursive", "scanline", "label + open", "labelled" };
+
+// Opens the door at each of seeds (skipping any already opened) on a copy
+// of cells, and returns the time taken.
+static double Open(Map& map, const BYTE* cells, const std::vector<DWORD>& seeds, OpenWay way)
+{
+	memcpy(map.Cell, cells, Map::NumCells);
+	map.OnCellsReplaced();
+	if(way == kLabelled)
+	{
+		map.LabelLocks();
+	}
+	BenchTimer timer;
+	for(size_t i = 0; i < seeds.size(); i++)
+	{
+		switch(way)
+		{
+		case kRecursive:
+			OpenLockRecursive(map, seeds[i]);
+			break;
+		case kScanline:
+			map.OpenLockFill(seeds[i]);
+			break;
+		default:
+			map.OpenLockIndex(seeds[i]);
+			break;
+		}
+	}
+	return timer.Seconds();
+}
+
+static int Run(const char* name, Map& map, const std::vector<BYTE>& levels, const std::vector<std::vector<DWORD> >& seeds,
+	DWORD rounds)
+{
+	DWORD numMaps = (DWORD) seeds.size();
+	std::vector<BYTE> expected(levels.size());
+	for(DWORD m = 0; m < numMaps; m++)
+	{
+		Open(map, &levels[m * Map::NumCells], seeds[m], kRecursive);
+		memcpy(&expected[m * Map::NumCells], map.Cell, Map::NumCells);
+	}
+	int result = 0;
+	for(DWORD way = 0; way < kNumWays; way++)
+	{
+		double seconds = 0;
+		for(DWORD r = 0; r < rounds; r++)
+		{
+			for(DWORD m = 0; m < numMaps; m++)
+			{
+				seconds += Open(map, &levels[m * Map::NumCells], seeds[m], (OpenWay) way);
+				if(r == 0 && memcmp(map.Cell, &expected[m * Map::NumCells], Map::NumCells))
+				{
+					fprintf(stderr, "%s map %u: %s opened different cells\n", name, m, kWayNames[way]);
+					result = 1;
+				}
+			}
+		}
+		char label[64];
+		snprintf(label, sizeof(label), "%s %s us", name, kWayNames[way]);
+		printf("%-28s %10.2f\n", label, seconds * 1e6 / ((double) rounds * numMaps));
+	}
+	return result;
+}
+
+int BenchLocks(const BenchOptions& options)
+{
+	static Map map;
+	DWORD rounds = std::max<DWORD>(1, options.iterations / 100);
+
+	// One door filling the inside of the map, opened from the middle.
+	std::vector<BYTE> field(Map::NumCells);
+	map.Init();
+	for(DWORD i = 0; i < Map::NumCells; i++)
+	{
+		field[i] = Map::IsBorder(i) ? kWall : kLock;
+	}
+	std::vector<std::vector<DWORD> > fieldSeeds(1, std::vector<DWORD>(1, Map::Index(Map::Width / 2, Map::Height / 2)));
+	int result = Run("60x30 field", map, field, fieldSeeds, rounds);
+
+	// Every door of every level, from its first cell.
+	Map::PreloadLevels();
+	std::vector<BYTE> levels(Map::NumLevels * Map::NumCells);
+	std::vector<std::vector<DWORD> > levelSeeds(Map::NumLevels);
+	DWORD doors = 0;
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		map.LoadLevel(level);
+		memcpy(&levels[level * Map::NumCells], map.Cell, Map::NumCells);
+		map.LabelLocks();
+		for(DWORD c = 0; c + 1 < map.lockStart.size(); c++)
+		{
+			levelSeeds[level].push_back(map.lockCells[map.lockStart[c]]);
+		}
+		doors += (DWORD) levelSeeds[level].size();
+	}
+	printf("%u doors on %u levels\n", doors, Map::NumLevels);
+	result |= Run("level", map, levels, levelSeeds, rounds);
+	return result;
+}
@@ -0,0 +1,176 @@
+#include "Bench.h"
+#include "../World.h"
+
+#include <stdio.h>
+#include <vector>
+
+// Players stand at the level's entrance while the monsters hunt them; the
+// world restarts the level whenever the party dies. Damage per 1000 ticks
+// shows how well each mode gets monsters to the players, ticks/sec what
+// it costs.
+struct PathingResult
+{
+	double ticksPerSecond;
+	double damagePer1000;
+};
+
+// Level index used for a crowded arena: an empty map with four players in
+// the middle and a quarter of the cells holding monsters or generators.
+static const DWORD kArena = Map::NumLevels;
+
+static void Setup(World& world, DWORD level)
+{
+	world.Init();
+	if(level != kArena)
+	{
+		world.LoadLevel(level);
+		return;
+	}
+	world.numPlayers = World::PlayerCount;
+	for(DWORD i = 0; i < world.numPlayers; i++)
+	{
+		world.player[i].Init();
+	}
+	static const MapData kCrowd[] = { kGhost, kSmiley, kBig, kGhost, kSmiley, kBig, kGen1, kGen2, kGen3 };
+	Random fill(level);
+	for(DWORD y = 1; y < Map::Height - 1; y++)
+	{
+		for(DWORD x = 1; x < Map::Width - 1; x++)
+		{
+			if(fill.Get(4) == 0)
+			{
+				world.map.Set(x, y, kCrowd[fill.Get(sizeof(kCrowd) / sizeof(kCrowd[0]))]);
+			}
+		}
+	}
+	world.map.Set(Map::Width / 2, Map::Height / 2, kUp);
+	world.SetPlayerPositions();
+}
+
+static PathingResult RunPathing(DWORD level, MonsterPathing pathing, const BenchOptions& options)
+{
+	static World world;
+	world.Seed(options.seed + level);
+	world.SetMonsterPathing(pathing);
+	Setup(world, level);
+
+	DWORD damage = 0;
+	BenchTimer timer;
+	for(DWORD t = 0; t < options.ticks; t++)
+	{
+		DWORD before = 0;
+		for(DWORD i = 0; i < world.numPlayers; i++)
+		{
+			before += world.player[i].health;
+		}
+		world.Update();
+		DWORD after = 0;
+		for(DWORD i = 0; i < world.numPlayers; i++)
+		{
+			after += world.player[i].health;
+		}
+		damage += before - after;
+		if(world.IsGameOver())
+		{
+			Setup(world, level);
+		}
+	}
+	PathingResult result;
+	result.ticksPerSecond = options.ticks / timer.Seconds();
+	result.damagePer1000 = damage * 1000.0 / options.ticks;
+	return result;
+}
+
+// Cost of choosing directions alone: every monster in the active region
+// of the crowded arena picks a direction, once by distance to each player
+// and once by building the field and looking the answer up.
+static void RunDecisions(const BenchOptions& options)
+{
+	static World world;
+	world.Seed(options.seed);
+	Setup(world, kArena);
+	world.Update();
+
+	float cogX;
+	float cogY;
+	DWORD startX;
+	DWORD startY;
+	DWORD endX;
+	DWORD endY;
+	world.GetCOG(cogX, cogY);
+	world.map.GetActive(cogX, cogY, startX, startY, endX, endY);
+	std::vector<DWORD> monsters;
+	for(DWORD y = startY; y < endY; y++)
+	{
+		for(DWORD x = startX; x < endX; x++)
+		{
+			MapData d = world.map.Get(x, y);
+			if(d >= kGhost && d <= kBig)
+			{
+				monsters.push_back(x + y * Map::Width);
+			}
+		}
+	}
+
+	DWORD sum = 0;
+	BenchTimer directTimer;
+	for(DWORD i = 0; i < options.iterations; i++)
+	{
+		for(size_t m = 0; m < monsters.size(); m++)
+		{
+			sum += world.GetDirectionOfNearestPlayer(monsters[m] % Map::Width, monsters[m] / Map::Width);
+		}
+	}
+	double directSeconds = directTimer.Seconds();
+
+	static FlowField<Map::ViewWidth + 1, Map::ViewHeight + 1> field;
+	BenchTimer flowTimer;
+	for(DWORD i = 0; i < options.iterations; i++)
+	{
+		field.Build(world.map, startX, startY, endX, endY, world.targetX, world.targetY, world.numTargets);
+		for(size_t m = 0; m < monsters.size(); m++)
+		{
+			sum += field.Get(monsters[m] % Map::Width, monsters[m] / Map::Width);
+		}
+	}
+	double flowSeconds = flowTimer.Seconds();
+
+	BenchTimer cachedTimer;
+	for(DWORD i = 0; i < options.iterations; i++)
+	{
+		field.Update(world.map, startX, startY, endX, endY, world.targetX, world.targetY, world.numTargets);
+		for(size_t m = 0; m < monsters.size(); m++)
+		{
+			sum += field.Get(monsters[m] % Map::Width, monsters[m] / Map::Width);
+		}
+	}
+	double cachedSeconds = cachedTimer.Seconds();
+
+	double calls = (double) options.iterations * monsters.size();
+	printf("direction choice, %u monsters, %u players in view (checksum %u):\n",
+		(DWORD) monsters.size(), world.numTargets, sum & 0xff);
+	printf("  direct  %6.2f ns/monster\n", directSeconds * 1e9 / calls);
+	printf("  flow    %6.2f ns/monster, rebuilding the field every time\n", flowSeconds * 1e9 / calls);
+	printf("  flow    %6.2f ns/monster, field reused while nothing it depends on changed\n", cachedSeconds * 1e9 / calls);
+}
+
+int BenchPathing(const BenchOptions& options)
+{
+	RunDecisions(options);
+
+	printf("level   direct ticks/s  dmg/1k    flow ticks/s  dmg/1k\n");
+	double directTotal = 0;
+	double flowTotal = 0;
+	for(DWORD level = 0; level <= kArena; level++)
+	{
+		PathingResult direct = RunPathing(level, kPathDirect, options);
+		PathingResult flow = RunPathing(level, kPathFlowField, options);
+		directTotal += direct.ticksPerSecond;
+		flowTotal += flow.ticksPerSecond;
+		printf("  %c     %12.0f  %6.1f    %12.0f  %6.1f\n", level == kArena ? '*' : (char) ('a' + level),
+			direct.ticksPerSecond, direct.damagePer1000, flow.ticksPerSecond, flow.damagePer1000);
+	}
+	printf("mean    %12.0f            %12.0f\n", directTotal / (kArena + 1), flowTotal / (kArena + 1));
+	printf("(* = crowded open arena, four players)\n");
+	return 0;
+}
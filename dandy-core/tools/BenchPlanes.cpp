@@ -0,0 +1,140 @@
+#include "Bench.h"
+#include "../Planes.h"
+#include "../Random.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Feature plane encoding: the scalar loop against the SSE2 and AVX2 kernels,
+// for a batch of whole maps and a batch of the 20x10 views around a player,
+// into byte and float planes. The maps are real levels with a few monsters
+// and players scattered over them.
+
+static const DWORD kBatch = 256;
+
+template<class T>
+struct PlaneKernel
+{
+	const char* name;
+	bool (*func)(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, T* out, const PlaneStrides& strides);
+};
+
+template<class T>
+static bool Scalar(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, T* out, const PlaneStrides& strides)
+{
+	EncodePlanesScalar(views, numViews, width, height, out, strides);
+	return true;
+}
+
+template<class T>
+static bool Dispatched(const PlaneView* views, DWORD numViews, DWORD width, DWORD height, T* out, const PlaneStrides& strides)
+{
+	EncodePlanes(views, numViews, width, height, out, strides);
+	return true;
+}
+
+template<class T>
+static int Run(const char* type, const std::vector<PlaneView>& views, DWORD width, DWORD height, DWORD rounds)
+{
+	static const PlaneKernel<T> kKernels[] =
+	{
+		{ "scalar", Scalar<T> },
+		{ "sse2", EncodePlanesSSE2 },
+		{ "avx2", EncodePlanesAVX2 },
+		{ "EncodePlanes", Dispatched<T> },
+	};
+	// Padded rows and planes, as a tensor with aligned rows would have.
+	PlaneStrides strides;
+	strides.row = (width + 15) & ~15;
+	strides.plane = strides.row * height + 16;
+	strides.view = strides.plane * kNumFeaturePlanes;
+	PlaneStrides dense = Planes::Dense(width, height);
+	DWORD numViews = (DWORD) views.size();
+
+	std::vector<T> expected(strides.view * numViews);
+	std::vector<T> out(strides.view * numViews);
+	std::vector<T> expectedDense(dense.view * numViews);
+	std::vector<T> outDense(dense.view * numViews);
+	EncodePlanesScalar(&views[0], numViews, width, height, &expected[0], strides);
+	EncodePlanesScalar(&views[0], numViews, width, height, &expectedDense[0], dense);
+
+	int result = 0;
+	for(DWORD k = 0; k < sizeof(kKernels) / sizeof(kKernels[0]); k++)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "%dx%d %s %s", width, height, type, kKernels[k].name);
+		memset(&out[0], 0x7f, out.size() * sizeof(T));
+		memset(&outDense[0], 0x7f, outDense.size() * sizeof(T));
+		if(!kKernels[k].func(&views[0], numViews, width, height, &out[0], strides))
+		{
+			printf("%-28s %10s\n", name, "unavailable");
+			continue;
+		}
+		kKernels[k].func(&views[0], numViews, width, height, &outDense[0], dense);
+		// Padding is left alone, so compare only what was written.
+		for(DWORD v = 0; v < numViews; v++)
+		{
+			for(DWORD p = 0; p < kNumFeaturePlanes; p++)
+			{
+				for(DWORD y = 0; y < height; y++)
+				{
+					size_t at = v * strides.view + p * strides.plane + y * strides.row;
+					if(memcmp(&out[at], &expected[at], width * sizeof(T)))
+					{
+						fprintf(stderr, "%s: view %u plane %u row %u differs from the scalar loop\n", name, v, p, y);
+						result = 1;
+					}
+				}
+			}
+		}
+		if(memcmp(&outDense[0], &expectedDense[0], outDense.size() * sizeof(T)))
+		{
+			fprintf(stderr, "%s: dense planes differ from the scalar loop\n", name);
+			result = 1;
+		}
+
+		BenchTimer timer;
+		for(DWORD r = 0; r < rounds; r++)
+		{
+			kKernels[k].func(&views[0], numViews, width, height, &out[0], strides);
+		}
+		double ns = timer.Seconds() * 1e9 / ((double) rounds * numViews);
+		printf("%-28s %10.1f ns/view %8.2f GB/s out\n", name, ns, (double) kNumFeaturePlanes * width * height * sizeof(T) / ns);
+	}
+	return result;
+}
+
+int BenchPlanes(const BenchOptions& options)
+{
+	Map::PreloadLevels();
+	std::vector<Map> maps(kBatch);
+	std::vector<PlaneView> full(kBatch);
+	std::vector<PlaneView> around(kBatch);
+	Random rng(options.seed);
+	for(DWORD i = 0; i < kBatch; i++)
+	{
+		Map& map = maps[i];
+		map.LoadLevel(i % Map::NumLevels);
+		for(DWORD n = 0; n < 64; n++)
+		{
+			DWORD x = 1 + rng.Get(Map::Width - 2);
+			DWORD y = 1 + rng.Get(Map::Height - 2);
+			if(map.Get(x, y) == kSpace)
+			{
+				map.Set(x, y, (MapData) (n < 4 ? kPlayer0 + n : kGhost + rng.Get(3)));
+			}
+		}
+		full[i] = Planes::Full(map.Cell);
+		around[i] = Planes::Around(map.Cell, rng.Get(Map::Width), rng.Get(Map::Height));
+	}
+
+	DWORD rounds = std::max<DWORD>(1, options.iterations / kBatch);
+	int result = 0;
+	printf("EncodePlanes uses %s, %u views per call\n", EncodePlanesKernel(), kBatch);
+	result |= Run<BYTE>("u8", full, Map::Width, Map::Height, rounds / 8 + 1);
+	result |= Run<float>("f32", full, Map::Width, Map::Height, rounds / 8 + 1);
+	result |= Run<BYTE>("u8", around, Map::ViewWidth, Map::ViewHeight, rounds);
+	result |= Run<float>("f32", around, Map::ViewWidth, Map::ViewHeight, rounds);
+	return result;
+}
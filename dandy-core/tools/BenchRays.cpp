@@ -0,0 +1,182 @@
+#include "Bench.h"
+#include "RandomPad.h"
+#include "../RaySensors.h"
+
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Ray sensors for every player of a batch of four-player Xbox 360 games on
+// every shipped level: reading the map's ray tables against stepping the
+// grid, and what keeping the tables up to date adds to a tick. Two copies
+// of each game run on the same input, one with tables and one without;
+// their sensors must agree on every tick, and now and then every ray from
+// every cell is checked against a cast. The same is then checked on a
+// 600x300 map, whose distances need words.
+
+static const DWORD kWorlds = 16;
+static const DWORD kCheckTicks = 300;
+
+template<class MapType>
+static bool CheckTables(const MapType& map)
+{
+	for(DWORD y = 0; y < MapType::Height; y++)
+	{
+		for(DWORD x = 0; x < MapType::Width; x++)
+		{
+			for(DWORD dir = 0; dir < 8; dir++)
+			{
+				if(map.rays.Distance(MapType::Index(x, y), dir) != RaySensors::Cast(map, x, y, dir))
+				{
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+static int CheckLarge(const BenchOptions& options)
+{
+	typedef GameT<Xbox360Rules, LargeGeometry<600, 300> > GameType;
+	typedef WorldT<Xbox360Rules, LargeGeometry<600, 300> > WorldType;
+	typedef RaySensorT<WorldType::Map::CellRays::Dist> Sensor;
+	std::unique_ptr<GameType> withTables(new GameType);
+	std::unique_ptr<GameType> without(new GameType);
+	RandomPad pads[GameType::PlayerCount];
+	Sensor fromTables[GameType::PlayerCount];
+	Sensor fromSteps[GameType::PlayerCount];
+	withTables->world.map.EnableRays(true);
+	for(DWORD i = 0; i < GameType::PlayerCount; i++)
+	{
+		pads[i].Seed(options.seed * GameType::PlayerCount + i);
+		withTables->SetConnected(i, true);
+		without->SetConnected(i, true);
+	}
+	withTables->Start(options.seed);
+	without->Start(options.seed);
+	DWORD ticks = std::max<DWORD>(1, options.ticks / kWorlds);
+	for(DWORD t = 0; t < ticks; t++)
+	{
+		for(DWORD i = 0; i < GameType::PlayerCount; i++)
+		{
+			BYTE buttons = pads[i].Next();
+			withTables->SetButtons(i, buttons);
+			without->SetButtons(i, buttons);
+		}
+		withTables->Step();
+		without->Step();
+		RaySensors::Sense(withTables->world, fromTables);
+		RaySensors::Sense(without->world, fromSteps);
+		if(memcmp(fromTables, fromSteps, sizeof(fromTables)))
+		{
+			fprintf(stderr, "600x300 tick %u: sensors from the tables differ from stepping\n", t);
+			return 1;
+		}
+	}
+	if(!CheckTables(withTables->world.map))
+	{
+		fprintf(stderr, "600x300: ray tables differ from casting\n");
+		return 1;
+	}
+	return 0;
+}
+
+int BenchRays(const BenchOptions& options)
+{
+	std::vector<Game360> withTables(kWorlds);
+	std::vector<Game360> without(kWorlds);
+	std::vector<const World360*> tableWorlds(kWorlds);
+	std::vector<const World360*> stepWorlds(kWorlds);
+	std::vector<RandomPad> pads(kWorlds * World360::PlayerCount);
+	std::vector<RaySensor> fromTables(kWorlds * World360::PlayerCount);
+	std::vector<RaySensor> fromSteps(kWorlds * World360::PlayerCount);
+	double tableStepTime = 0;
+	double plainStepTime = 0;
+	double tableSenseTime = 0;
+	double stepSenseTime = 0;
+	uint64_t ticks = 0;
+	uint64_t sensed = 0;
+	DWORD sink = 0;
+	int result = 0;
+
+	for(DWORD w = 0; w < kWorlds; w++)
+	{
+		tableWorlds[w] = &withTables[w].world;
+		stepWorlds[w] = &without[w].world;
+		for(DWORD i = 0; i < World360::PlayerCount; i++)
+		{
+			withTables[w].SetConnected(i, true);
+			without[w].SetConnected(i, true);
+		}
+		withTables[w].world.map.EnableRays(true);
+	}
+	DWORD levelTicks = std::max<DWORD>(1, options.ticks / kWorlds);
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		for(DWORD w = 0; w < kWorlds; w++)
+		{
+			for(DWORD i = 0; i < World360::PlayerCount; i++)
+			{
+				pads[w * World360::PlayerCount + i].Seed((options.seed + w) * World360::PlayerCount + i);
+			}
+			withTables[w].Start(options.seed + level * kWorlds + w);
+			withTables[w].world.LoadLevel(level);
+			without[w].Start(options.seed + level * kWorlds + w);
+			without[w].world.LoadLevel(level);
+		}
+		for(DWORD t = 0; t < levelTicks; t++)
+		{
+			for(DWORD w = 0; w < kWorlds; w++)
+			{
+				for(DWORD i = 0; i < World360::PlayerCount; i++)
+				{
+					BYTE buttons = pads[w * World360::PlayerCount + i].Next();
+					withTables[w].SetButtons(i, buttons);
+					without[w].SetButtons(i, buttons);
+				}
+				BenchTimer tableStep;
+				withTables[w].Step();
+				tableStepTime += tableStep.Seconds();
+				BenchTimer plainStep;
+				without[w].Step();
+				plainStepTime += plainStep.Seconds();
+			}
+			ticks += kWorlds;
+
+			BenchTimer tableSense;
+			RaySensors::Sense(&tableWorlds[0], kWorlds, &fromTables[0]);
+			tableSenseTime += tableSense.Seconds();
+			BenchTimer stepSense;
+			RaySensors::Sense(&stepWorlds[0], kWorlds, &fromSteps[0]);
+			stepSenseTime += stepSense.Seconds();
+			sensed += kWorlds * World360::PlayerCount;
+
+			if(memcmp(&fromTables[0], &fromSteps[0], fromTables.size() * sizeof(RaySensor)))
+			{
+				fprintf(stderr, "level %c tick %u: sensors from the tables differ from stepping\n", 'a' + level, t);
+				return 1;
+			}
+			if(t % kCheckTicks == 0)
+			{
+				for(DWORD w = 0; w < kWorlds; w++)
+				{
+					if(!CheckTables(withTables[w].world.map))
+					{
+						fprintf(stderr, "level %c tick %u: world %u ray tables differ from casting\n", 'a' + level, t, w);
+						result = 1;
+					}
+				}
+			}
+			sink += fromTables[t % fromTables.size()].distance[t & 7];
+		}
+	}
+
+	printf("%-28s %10.1f\n", "table sense ns/player", tableSenseTime * 1e9 / sensed);
+	printf("%-28s %10.1f\n", "stepping sense ns/player", stepSenseTime * 1e9 / sensed);
+	printf("%-28s %10.1f\n", "tick with tables ns", tableStepTime * 1e9 / ticks);
+	printf("%-28s %10.1f\n", "tick without tables ns", plainStepTime * 1e9 / ticks);
+	printf("(sink %u)\n", sink & 1);
+	return result | CheckLarge(options);
+}
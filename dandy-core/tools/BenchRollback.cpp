@@ -0,0 +1,70 @@
+#include "Bench.h"
+#include "../Loopback.h"
+#include "../Rollback.h"
+#include "RandomPad.h"
+
+#include <stdio.h>
+
+// Worst case for rollback: two peers whose packets take kMaxPrediction - 1
+// frames to arrive, one of them turning every frame so that every one of
+// its inputs is mispredicted. Each frame of the other peer then restores a
+// snapshot and re-simulates about kMaxPrediction ticks, all of which has
+// to fit in the 16.7 ms frame.
+
+int BenchRollback(const BenchOptions& options)
+{
+	static RollbackSession sessions[2];
+	static const DWORD kFrameMicros = 16667;
+	LoopbackNetwork net(2, options.seed);
+	net.SetLatency((RollbackSession::kMaxPrediction - 1) * kFrameMicros, 0);
+	RandomPad pad;
+	pad.Seed(options.seed);
+	for(DWORD i = 0; i < 2; i++)
+	{
+		sessions[i].Start(options.seed, i, 2);
+	}
+
+	std::vector<BYTE> packet;
+	BYTE out[RollbackSession::kMaxPacketSize];
+	double total = 0;
+	double slowest = 0;
+	DWORD timed = 0;
+	for(DWORD f = 0; sessions[0].frame < options.ticks; f++)
+	{
+		for(DWORD i = 0; i < 2; i++)
+		{
+			RollbackSession& s = sessions[i];
+			DWORD from;
+			while(net.Receive(i, packet, from))
+			{
+				s.ReadPacket(packet.data(), (DWORD) packet.size());
+			}
+			BYTE buttons = pad.Next();
+			if(i == 1)
+			{
+				buttons = (s.frame & 1) ? GamePad::kLeft : GamePad::kRight;
+			}
+			BenchTimer timer;
+			bool advanced = s.AdvanceFrame(buttons);
+			double seconds = timer.Seconds();
+			if(i == 0 && advanced)
+			{
+				total += seconds;
+				slowest = std::max(slowest, seconds);
+				++timed;
+			}
+			net.Send(i, 1 - i, out, s.WritePacket(1 - i, out));
+		}
+		net.Advance(kFrameMicros);
+	}
+
+	const RollbackSession::Stats& stats = sessions[0].stats;
+	printf("%-28s %10u\n", "frames", stats.frames);
+	printf("%-28s %10u\n", "rollbacks", stats.rollbacks);
+	printf("%-28s %10.2f\n", "ticks re-simulated avg", stats.resimulated / (double) std::max<DWORD>(1, stats.rollbacks));
+	printf("%-28s %10u\n", "ticks re-simulated max", stats.maxResimulated);
+	printf("%-28s %10.2f\n", "frame us avg", total * 1e6 / std::max<DWORD>(1, timed));
+	printf("%-28s %10.2f\n", "frame us max", slowest * 1e6);
+	printf("%-28s %10.3f\n", "budget used avg %", total * 1e6 / std::max<DWORD>(1, timed) * 100 / kFrameMicros);
+	return stats.rollbacks ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#include "Bench.h"
+#include "RandomPad.h"
+
+#include <stdio.h>
+
+// Whole-game throughput of each rules variant, started on every shipped
+// level in turn with two scripted players.
+
+template<class Rules>
+static double TicksPerSecond(const BenchOptions& options)
+{
+	static GameT<Rules> game;
+	RandomPad pads[World::PlayerCount];
+	BenchTimer timer;
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		for(DWORD i = 0; i < World::PlayerCount; i++)
+		{
+			pads[i].Seed(options.seed * World::PlayerCount + i);
+			game.SetConnected(i, i < 2);
+		}
+		game.Start(options.seed + level);
+		game.Step();
+		game.world.LoadLevel(level);
+		for(DWORD t = 0; t < options.ticks; t++)
+		{
+			for(DWORD i = 0; i < World::PlayerCount; i++)
+			{
+				game.SetButtons(i, pads[i].Next());
+			}
+			game.Step();
+		}
+	}
+	return options.ticks * (double) Map::NumLevels / timer.Seconds();
+}
+
+int BenchRules(const BenchOptions& options)
+{
+	printf("%-14s %12s\n", "rules", "ticks/sec");
+	printf("%-14s %12.0f\n", "classic", TicksPerSecond<ClassicRules>(options));
+	printf("%-14s %12.0f\n", "xbox 360", TicksPerSecond<Xbox360Rules>(options));
+	return 0;
+}
@@ -0,0 +1,120 @@
+#include "Bench.h"
+#include "RandomPad.h"
+
+#include <stdio.h>
+
+// Tree-search style forking on every shipped level: the game saves a
+// snapshot every tick, and every kDecisionTicks ticks forks kForks short
+// rollouts from it, once by Restore and once by copying the whole Game.
+// Both rollouts must end on the same checksum, and restoring the snapshot
+// into the game itself must give back the checksum it had when saved.
+
+static const DWORD kDecisionTicks = 60;
+static const DWORD kForks = 32;
+static const DWORD kRolloutTicks = 8;
+
+static void Rollout(Game& game, uint64_t seed)
+{
+	RandomPad pads[World::PlayerCount];
+	for(DWORD i = 0; i < World::PlayerCount; i++)
+	{
+		pads[i].Seed(seed * World::PlayerCount + i);
+	}
+	for(DWORD t = 0; t < kRolloutTicks; t++)
+	{
+		for(DWORD i = 0; i < World::PlayerCount; i++)
+		{
+			game.SetButtons(i, pads[i].Next());
+		}
+		game.Step();
+	}
+}
+
+int BenchSnapshot(const BenchOptions& options)
+{
+	static Game game;
+	static Game forked;
+	static Game copied;
+	Game::Snapshot snapshot;
+	RandomPad pads[World::PlayerCount];
+	double saveTime = 0;
+	double restoreTime = 0;
+	double copyTime = 0;
+	uint64_t saves = 0;
+	uint64_t rowsCopied = 0;
+	uint64_t forks = 0;
+	int result = 0;
+
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		for(DWORD i = 0; i < World::PlayerCount; i++)
+		{
+			pads[i].Seed(options.seed * World::PlayerCount + i);
+		}
+		game.Start(options.seed + level);
+		game.world.LoadLevel(level);
+		for(DWORD t = 0; t < options.ticks; t++)
+		{
+			for(DWORD i = 0; i < World::PlayerCount; i++)
+			{
+				game.SetButtons(i, pads[i].Next());
+			}
+			game.Step();
+
+			BenchTimer save;
+			rowsCopied += game.Save(snapshot);
+			saveTime += save.Seconds();
+			++saves;
+
+			if(t % kDecisionTicks != 0)
+			{
+				continue;
+			}
+			uint64_t saved = game.world.Checksum();
+			for(DWORD f = 0; f < kForks; f++)
+			{
+				uint64_t rolloutSeed = options.seed + t * kForks + f;
+				BenchTimer restore;
+				forked.Restore(snapshot);
+				restoreTime += restore.Seconds();
+				if(forked.world.Checksum() != saved)
+				{
+					fprintf(stderr, "level %c tick %u: restored fork differs\n", 'a' + level, t);
+					result = 1;
+				}
+				Rollout(forked, rolloutSeed);
+
+				BenchTimer copy;
+				copied = game;
+				copyTime += copy.Seconds();
+				Rollout(copied, rolloutSeed);
+
+				if(forked.world.Checksum() != copied.world.Checksum())
+				{
+					fprintf(stderr, "level %c tick %u: fork and copy rollouts differ\n", 'a' + level, t);
+					result = 1;
+				}
+				++forks;
+			}
+
+			// Rewinding the game itself only touches what the fork changed.
+			Rollout(game, options.seed + t);
+			game.Restore(snapshot);
+			if(game.world.Checksum() != saved)
+			{
+				fprintf(stderr, "level %c tick %u: rewind differs\n", 'a' + level, t);
+				result = 1;
+			}
+		}
+	}
+
+	double rows = rowsCopied / (double) saves;
+	printf("%-28s %10.1f\n", "save ns", saveTime * 1e9 / saves);
+	printf("%-28s %10.2f\n", "rows copied per save", rows);
+	printf("%-28s %10.0f\n", "bytes per snapshot",
+		sizeof(Game::Snapshot) + rows * sizeof(Map::Snapshot::Chunk));
+	printf("%-28s %10u\n", "bytes per Game", (DWORD) sizeof(Game));
+	printf("%-28s %10.1f\n", "fork by Restore ns", restoreTime * 1e9 / forks);
+	printf("%-28s %10.1f\n", "fork by copy ns", copyTime * 1e9 / forks);
+	return result;
+}
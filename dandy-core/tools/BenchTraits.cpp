@@ -0,0 +1,189 @@
+#include "Bench.h"
+#include "../Map.h"
+#include "../Random.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+// Cell classification by the old range tests and switch against one
+// kTileTraits load, over the cells of every shipped level and over
+// uniformly random cells (where the branches cannot be predicted).
+
+struct Pickups
+{
+	DWORD keys;
+	DWORD food;
+	DWORD bombs;
+	DWORD score;
+	DWORD moves;
+};
+
+static DWORD EntityChain(const std::vector<BYTE>& cells)
+{
+	DWORD count = 0;
+	for(size_t i = 0; i < cells.size(); i++)
+	{
+		BYTE d = cells[i];
+		if((d >= kGhost && d <= kBig) || (d >= kGen1 && d <= kGen3))
+		{
+			count += d;
+		}
+	}
+	return count;
+}
+
+static DWORD EntityTable(const std::vector<BYTE>& cells)
+{
+	DWORD count = 0;
+	for(size_t i = 0; i < cells.size(); i++)
+	{
+		BYTE d = cells[i];
+		if(HasTrait(d, kTileEntity))
+		{
+			count += d;
+		}
+	}
+	return count;
+}
+
+static DWORD MonsterStepChain(const std::vector<BYTE>& cells)
+{
+	DWORD count = 0;
+	for(size_t i = 0; i < cells.size(); i++)
+	{
+		BYTE d = cells[i];
+		if(d == kSpace || (d >= kPlayer0 && d <= kPlayer3))
+		{
+			count += i & 7;
+		}
+	}
+	return count;
+}
+
+static DWORD MonsterStepTable(const std::vector<BYTE>& cells)
+{
+	DWORD count = 0;
+	for(size_t i = 0; i < cells.size(); i++)
+	{
+		if(HasTrait(cells[i], kTileMonsterStep))
+		{
+			count += i & 7;
+		}
+	}
+	return count;
+}
+
+static void PickupSwitch(const std::vector<BYTE>& cells, Pickups& p)
+{
+	for(size_t i = 0; i < cells.size(); i++)
+	{
+		bool move = false;
+		switch(cells[i])
+		{
+		case kSpace:
+			move = true;
+			break;
+		case kKey:
+			++p.keys;
+			move = true;
+			break;
+		case kFood:
+			++p.food;
+			move = true;
+			break;
+		case kMoney:
+			p.score += 10;
+			move = true;
+			break;
+		case kBomb:
+			++p.bombs;
+			move = true;
+			break;
+		default:
+			break;
+		}
+		p.moves += move;
+	}
+}
+
+static void PickupTable(const std::vector<BYTE>& cells, Pickups& p)
+{
+	for(size_t i = 0; i < cells.size(); i++)
+	{
+		const TileTraits& traits = TraitsOf(cells[i]);
+		if(traits.flags & kTileWalkable)
+		{
+			p.keys += traits.keys;
+			p.food += traits.food;
+			p.bombs += traits.bombs;
+			p.score += traits.score;
+			++p.moves;
+		}
+	}
+}
+
+template<class F>
+static double NsPerCell(const std::vector<BYTE>& cells, DWORD rounds, const F& f)
+{
+	BenchTimer timer;
+	for(DWORD r = 0; r < rounds; r++)
+	{
+		f();
+	}
+	return timer.Seconds() * 1e9 / ((double) rounds * cells.size());
+}
+
+static int Run(const char* name, const std::vector<BYTE>& cells, DWORD rounds)
+{
+	int result = 0;
+	volatile DWORD sink = 0;
+	Pickups a = Pickups();
+	Pickups b = Pickups();
+	PickupSwitch(cells, a);
+	PickupTable(cells, b);
+	if(EntityChain(cells) != EntityTable(cells) || MonsterStepChain(cells) != MonsterStepTable(cells)
+		|| a.keys != b.keys || a.food != b.food || a.bombs != b.bombs || a.score != b.score || a.moves != b.moves)
+	{
+		fprintf(stderr, "%s: table and branches disagree\n", name);
+		result = 1;
+	}
+
+	double entityChain = NsPerCell(cells, rounds, [&] { sink += EntityChain(cells); });
+	double entityTable = NsPerCell(cells, rounds, [&] { sink += EntityTable(cells); });
+	double stepChain = NsPerCell(cells, rounds, [&] { sink += MonsterStepChain(cells); });
+	double stepTable = NsPerCell(cells, rounds, [&] { sink += MonsterStepTable(cells); });
+	double pickupSwitch = NsPerCell(cells, rounds, [&] { Pickups p = Pickups(); PickupSwitch(cells, p); sink += p.moves; });
+	double pickupTable = NsPerCell(cells, rounds, [&] { Pickups p = Pickups(); PickupTable(cells, p); sink += p.moves; });
+
+	printf("%s cells, ns/cell:\n", name);
+	printf("  %-22s %8.3f %8.3f\n", "entity test", entityChain, entityTable);
+	printf("  %-22s %8.3f %8.3f\n", "monster step test", stepChain, stepTable);
+	printf("  %-22s %8.3f %8.3f\n", "player step + pickup", pickupSwitch, pickupTable);
+	return result;
+}
+
+int BenchTraits(const BenchOptions& options)
+{
+	std::vector<BYTE> levels;
+	for(DWORD level = 0; level < Map::NumLevels; level++)
+	{
+		const BYTE* cells = Map::GetLevelCells(level);
+		if(cells)
+		{
+			levels.insert(levels.end(), cells, cells + Map::NumCells);
+		}
+	}
+	std::vector<BYTE> random(levels.size());
+	Random fill(options.seed);
+	for(size_t i = 0; i < random.size(); i++)
+	{
+		random[i] = (BYTE) fill.Get(kNumMapData);
+	}
+
+	DWORD rounds = std::max<DWORD>(1, options.iterations / 1000);
+	printf("%-24s %8s %8s\n", "", "branches", "table");
+	int result = Run("level", levels, rounds);
+	result |= Run("random", random, rounds);
+	return result;
+}
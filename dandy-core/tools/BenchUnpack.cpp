@@ -0,0 +1,89 @@
+#include "Bench.h"
+#include "../Map.h"
+#include "../Random.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Level nibble unpacking: the scalar loop against the SSE2 and AVX2
+// kernels, for one level at a time (LoadLevel, the level cache) and for a
+// large batch of levels back to back (Map::DecodeLevels).
+
+typedef bool (*KernelFunc)(const BYTE* packed, BYTE* cells, DWORD numPacked);
+
+static bool Scalar(const BYTE* packed, BYTE* cells, DWORD numPacked)
+{
+	UnpackNibblesScalar(packed, cells, numPacked);
+	return true;
+}
+
+static bool Dispatched(const BYTE* packed, BYTE* cells, DWORD numPacked)
+{
+	UnpackNibbles(packed, cells, numPacked);
+	return true;
+}
+
+int BenchUnpack(const BenchOptions& options)
+{
+	static const struct
+	{
+		const char* name;
+		KernelFunc func;
+	} kKernels[] =
+	{
+		{ "scalar", Scalar },
+		{ "sse2", UnpackNibblesSSE2 },
+		{ "avx2", UnpackNibblesAVX2 },
+		{ "UnpackNibbles", Dispatched },
+	};
+	const DWORD kBatchLevels = 4096;
+
+	std::vector<BYTE> packed(kBatchLevels * Map::PackedLevelSize);
+	Random fill(options.seed);
+	for(size_t i = 0; i < packed.size(); i++)
+	{
+		packed[i] = (BYTE) fill.Next();
+	}
+	std::vector<BYTE> expected(kBatchLevels * Map::NumCells);
+	std::vector<BYTE> cells(kBatchLevels * Map::NumCells);
+	UnpackNibblesScalar(&packed[0], &expected[0], (DWORD) packed.size());
+
+	DWORD batchRounds = std::max<DWORD>(1, options.iterations / kBatchLevels);
+	int result = 0;
+	printf("UnpackNibbles uses %s\n", UnpackNibblesKernel());
+	printf("%-14s %14s %14s\n", "kernel", "ns/level", "batch GB/s out");
+	for(DWORD k = 0; k < sizeof(kKernels) / sizeof(kKernels[0]); k++)
+	{
+		// Odd lengths and offsets exercise the scalar tails.
+		memset(&cells[0], 0xff, cells.size());
+		if(!kKernels[k].func(&packed[1], &cells[2], (DWORD) packed.size() - 3))
+		{
+			printf("%-14s %14s\n", kKernels[k].name, "unavailable");
+			continue;
+		}
+		if(memcmp(&cells[2], &expected[2], cells.size() - 6))
+		{
+			fprintf(stderr, "%s: output differs from the scalar loop\n", kKernels[k].name);
+			result = 1;
+		}
+
+		BenchTimer single;
+		for(DWORD i = 0; i < options.iterations; i++)
+		{
+			DWORD level = i % kBatchLevels;
+			kKernels[k].func(&packed[level * Map::PackedLevelSize], &cells[level * Map::NumCells], Map::PackedLevelSize);
+		}
+		double singleNs = single.Seconds() * 1e9 / options.iterations;
+
+		BenchTimer batch;
+		for(DWORD r = 0; r < batchRounds; r++)
+		{
+			kKernels[k].func(&packed[0], &cells[0], (DWORD) packed.size());
+		}
+		double bytes = (double) cells.size() * batchRounds;
+		printf("%-14s %14.1f %14.2f\n", kKernels[k].name, singleNs, bytes / batch.Seconds() / 1e9);
+	}
+	return result;
+}
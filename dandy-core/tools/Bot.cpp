@@ -0,0 +1,217 @@
+// dandy-bot: plays a game with MctsBot players in the first --bots slots
+// and scripted pads in the rest, and reports how fast the bots search
+// (playouts/sec, per core) and how far they got. With an iteration budget
+// the game, and the checksum printed at the end, depend only on the
+// arguments and --trees, not on --threads; --budget-us searches each
+// decision for a fixed wall time instead.
+
+#include "../Bot.h"
+#include "RandomPad.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void Usage()
+{
+	fprintf(stderr,
+		"usage: dandy-bot [--bots N] [--players N] [--rules classic|360] [--ticks N] [--seed N]\n"
+		"                 [--iterations N] [--budget-us N] [--trees N] [--threads N]\n"
+		"                 [--ticks-per-action N] [--playout N] [--pathing direct|flow] [--levels DIR]\n");
+}
+
+struct BotOptions
+{
+	DWORD bots;
+	DWORD players;
+	DWORD ticks;
+	DWORD threads;
+	uint64_t seed;
+	MonsterPathing pathing;
+	MctsBot::Config config;
+};
+
+template<class Rules>
+static void Run(const BotOptions& options)
+{
+	static GameT<Rules> game;
+	// --threads counts the search threads including this one; 0 (the
+	// default) is one per core.
+	ThreadPool pool(options.threads > 0 ? options.threads - 1 : kThreadPoolAuto);
+	// Cores the search can keep busy: one per tree, up to the threads.
+	DWORD cores = std::min(pool.NumThreads() + 1, options.config.trees);
+	cores = std::min(cores, std::max(1u, std::thread::hardware_concurrency()));
+
+	std::vector<MctsBotT<Rules> > bots;
+	typename MctsBotT<Rules>::Config config;
+	config.iterations = options.config.iterations;
+	config.budgetMicros = options.config.budgetMicros;
+	config.trees = options.config.trees;
+	config.ticksPerAction = options.config.ticksPerAction;
+	config.playoutActions = options.config.playoutActions;
+	for(DWORD i = 0; i < options.bots; i++)
+	{
+		config.seed = options.seed * World::PlayerCount + i;
+		bots.push_back(MctsBotT<Rules>(i, config, &pool));
+	}
+	RandomPad pads[World::PlayerCount];
+	for(DWORD i = 0; i < World::PlayerCount; i++)
+	{
+		pads[i].Seed(options.seed * World::PlayerCount + i);
+		game.SetConnected(i, i < options.players);
+	}
+	game.world.SetMonsterPathing(options.pathing);
+	game.Start(options.seed);
+
+	BYTE buttons[World::PlayerCount] = { 0 };
+	DWORD restarts = 0;
+	DWORD maxLevel = 0;
+	for(DWORD t = 0; t < options.ticks; t++)
+	{
+		for(DWORD i = 0; i < World::PlayerCount; i++)
+		{
+			if(i >= options.bots)
+			{
+				buttons[i] = pads[i].Next();
+			}
+			else if(t % config.ticksPerAction == 0)
+			{
+				buttons[i] = MctsBotT<Rules>::ActionButtons(bots[i].Decide(game));
+			}
+			game.SetButtons(i, buttons[i]);
+		}
+		DWORD tick = game.world.tick;
+		game.Step();
+		if(game.world.tick < tick)
+		{
+			++restarts;
+		}
+		if(game.world.level > maxLevel)
+		{
+			maxLevel = game.world.level;
+		}
+	}
+
+	typename MctsBotT<Rules>::Stats total;
+	for(DWORD i = 0; i < bots.size(); i++)
+	{
+		const typename MctsBotT<Rules>::Stats& s = bots[i].stats;
+		total.decisions += s.decisions;
+		total.playouts += s.playouts;
+		total.ticks += s.ticks;
+		total.seconds += s.seconds;
+	}
+	printf("ticks       %u\n", options.ticks);
+	printf("bots        %u, %u trees on %u cores\n", options.bots, config.trees, cores);
+	printf("decisions   %u (%.0f us each)\n", total.decisions, total.decisions ? total.seconds * 1e6 / total.decisions : 0.0);
+	printf("playouts    %llu (%.0f per decision)\n", (unsigned long long) total.playouts,
+		total.decisions ? total.playouts / (double) total.decisions : 0.0);
+	if(total.seconds > 0)
+	{
+		printf("playouts/s  %.0f (%.0f per core)\n", total.playouts / total.seconds, total.playouts / total.seconds / cores);
+		printf("sim ticks/s %.0f\n", total.ticks / total.seconds);
+	}
+	printf("level       %u (best %u, %u restarts)\n", game.world.level, maxLevel, restarts);
+	for(DWORD i = 0; i < options.bots; i++)
+	{
+		const Player& p = game.world.player[i];
+		printf("bot %u       score %u health %u food %u keys %u bombs %u\n", i, p.score, p.health, p.food, p.keys, p.bombs);
+	}
+	printf("checksum    %016llx\n", (unsigned long long) game.world.Checksum());
+}
+
+int main(int argc, char** argv)
+{
+	BotOptions options;
+	options.bots = 1;
+	options.players = 2;
+	options.ticks = 3600;
+	options.threads = 0;
+	options.seed = 1;
+	options.pathing = kPathDirect;
+	bool xbox360 = false;
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--bots") && i + 1 < argc)
+		{
+			options.bots = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--players") && i + 1 < argc)
+		{
+			options.players = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--rules") && i + 1 < argc)
+		{
+			xbox360 = !strcmp(argv[++i], "360");
+		}
+		else if(!strcmp(argv[i], "--ticks") && i + 1 < argc)
+		{
+			options.ticks = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--seed") && i + 1 < argc)
+		{
+			options.seed = strtoull(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--iterations") && i + 1 < argc)
+		{
+			options.config.iterations = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--budget-us") && i + 1 < argc)
+		{
+			options.config.budgetMicros = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--trees") && i + 1 < argc)
+		{
+			options.config.trees = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--threads") && i + 1 < argc)
+		{
+			options.threads = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--ticks-per-action") && i + 1 < argc)
+		{
+			options.config.ticksPerAction = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--playout") && i + 1 < argc)
+		{
+			options.config.playoutActions = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--pathing") && i + 1 < argc)
+		{
+			options.pathing = !strcmp(argv[++i], "flow") ? kPathFlowField : kPathDirect;
+		}
+		else if(!strcmp(argv[i], "--levels") && i + 1 < argc)
+		{
+			Map::SetLevelDirectory(argv[++i]);
+		}
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+	if(options.bots > (xbox360 ? World::PlayerCount : ClassicRules::kStartPlayers)
+		|| options.config.trees == 0 || options.config.ticksPerAction == 0)
+	{
+		Usage();
+		return 1;
+	}
+	if(options.config.budgetMicros && !options.config.iterations)
+	{
+		options.config.iterations = 0xffffffff;
+	}
+	if(options.players < options.bots)
+	{
+		options.players = options.bots;
+	}
+
+	Map::PreloadLevels();
+	if(xbox360)
+	{
+		Run<Xbox360Rules>(options);
+	}
+	else
+	{
+		Run<ClassicRules>(options);
+	}
+	return 0;
+}
@@ -0,0 +1,347 @@
+#include "Server.h"
+#include "RandomPad.h"
+
+#include <chrono>
+#include <mutex>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const DWORD kBatch = 64;
+
+// One epoll loop driving a share of the simulated clients through a single
+// socket; the server tells clients apart by session id, not by address.
+class LoadGenerator::Thread
+{
+public:
+	Thread()
+	{
+		sock = -1;
+		timer = -1;
+		wake = -1;
+		poll = -1;
+		receiveBuffer.resize(kBatch * ServerProtocol::kMaxUpdateSize);
+	}
+
+	~Thread()
+	{
+		int fds[] = { sock, timer, wake, poll };
+		for(DWORD i = 0; i < 4; i++)
+		{
+			if(fds[i] >= 0)
+			{
+				close(fds[i]);
+			}
+		}
+	}
+
+	bool Open(DWORD serverPort, DWORD numServerWorkers, DWORD firstClient, DWORD numClients, uint64_t seed)
+	{
+		sock = OpenUdpSocket(0, true);
+		timer = OpenTickTimer();
+		wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		poll = epoll_create1(EPOLL_CLOEXEC);
+		if(sock < 0 || timer < 0 || wake < 0 || poll < 0)
+		{
+			return false;
+		}
+		int fds[] = { sock, timer, wake };
+		for(DWORD i = 0; i < 3; i++)
+		{
+			epoll_event event;
+			event.events = EPOLLIN;
+			event.data.fd = fds[i];
+			epoll_ctl(poll, EPOLL_CTL_ADD, fds[i], &event);
+		}
+
+		clients.resize(numClients);
+		for(DWORD i = 0; i < numClients; i++)
+		{
+			Client& c = clients[i];
+			c.session = (DWORD) Random::Mix(seed + firstClient + i);
+			c.pad.Seed(seed + firstClient + i);
+			memset(&c.server, 0, sizeof(c.server));
+			c.server.sin_family = AF_INET;
+			c.server.sin_port = htons((uint16_t) (serverPort + c.session % numServerWorkers));
+			c.server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			c.latest = ServerProtocol::kNoTick;
+			for(DWORD m = 0; m < kMirrors; m++)
+			{
+				c.mirrorTick[m] = ServerProtocol::kNoTick;
+			}
+			bySession[c.session] = i;
+		}
+		return true;
+	}
+
+	void Run()
+	{
+		for(;;)
+		{
+			epoll_event events[4];
+			int n = epoll_wait(poll, events, 4, -1);
+			if(n < 0 && errno != EINTR)
+			{
+				return;
+			}
+			for(int i = 0; i < n; i++)
+			{
+				int fd = events[i].data.fd;
+				if(fd == wake)
+				{
+					return;
+				}
+				if(fd == sock)
+				{
+					Receive();
+				}
+				else if(fd == timer)
+				{
+					uint64_t expirations = 0;
+					if(read(timer, &expirations, sizeof(expirations)) == sizeof(expirations) && expirations)
+					{
+						stats.ticks += expirations;
+						stats.lateTicks += expirations - 1;
+						SendInputs();
+					}
+				}
+			}
+			std::lock_guard<std::mutex> lock(statsMutex);
+			published.Add(stats);
+			stats.Clear();
+		}
+	}
+
+	void Stop()
+	{
+		uint64_t one = 1;
+		if(write(wake, &one, sizeof(one)) != sizeof(one))
+		{
+			MyDebugBreak();
+		}
+		thread.join();
+	}
+
+	std::thread thread;
+	std::mutex statsMutex;
+	NetStats published;
+
+private:
+	// Recent states each client can take a delta against.
+	static const DWORD kMirrors = 4;
+
+	struct Client
+	{
+		DWORD session;
+		RandomPad pad;
+		sockaddr_in server;
+		DWORD latest;
+		DWORD mirrorTick[kMirrors];
+		BYTE mirror[kMirrors][Map::NumCells];
+	};
+
+	void SendInputs()
+	{
+		BYTE buffers[kBatch][ServerProtocol::kInputSize];
+		iovec iov[kBatch];
+		mmsghdr messages[kBatch];
+		for(DWORD first = 0; first < clients.size(); first += kBatch)
+		{
+			DWORD count = std::min<DWORD>(kBatch, (DWORD) clients.size() - first);
+			for(DWORD i = 0; i < count; i++)
+			{
+				Client& c = clients[first + i];
+				ServerProtocol::WriteInput(buffers[i], c.session, 0, c.latest, c.pad.Next());
+				iov[i].iov_base = buffers[i];
+				iov[i].iov_len = ServerProtocol::kInputSize;
+				memset(&messages[i], 0, sizeof(messages[i]));
+				messages[i].msg_hdr.msg_iov = &iov[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+				messages[i].msg_hdr.msg_name = &c.server;
+				messages[i].msg_hdr.msg_namelen = sizeof(c.server);
+			}
+			int n = sendmmsg(sock, messages, count, 0);
+			if(n > 0)
+			{
+				stats.packetsOut += n;
+				stats.bytesOut += n * ServerProtocol::kInputSize;
+			}
+			stats.sessionTicks += count;
+		}
+	}
+
+	void Receive()
+	{
+		iovec iov[kBatch];
+		mmsghdr messages[kBatch];
+		for(;;)
+		{
+			for(DWORD i = 0; i < kBatch; i++)
+			{
+				iov[i].iov_base = &receiveBuffer[i * ServerProtocol::kMaxUpdateSize];
+				iov[i].iov_len = ServerProtocol::kMaxUpdateSize;
+				memset(&messages[i], 0, sizeof(messages[i]));
+				messages[i].msg_hdr.msg_iov = &iov[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+			}
+			int n = recvmmsg(sock, messages, kBatch, MSG_DONTWAIT, NULL);
+			if(n <= 0)
+			{
+				return;
+			}
+			for(int i = 0; i < n; i++)
+			{
+				stats.packetsIn++;
+				stats.bytesIn += messages[i].msg_len;
+				HandleUpdate(&receiveBuffer[i * ServerProtocol::kMaxUpdateSize], messages[i].msg_len);
+			}
+			if((DWORD) n < kBatch)
+			{
+				return;
+			}
+		}
+	}
+
+	// Rebuilds the map at the update's tick from the state it was based on.
+	void HandleUpdate(const BYTE* p, DWORD size)
+	{
+		if(size < ServerProtocol::kUpdateHeader || p[0] != ServerProtocol::kUpdate)
+		{
+			return;
+		}
+		std::unordered_map<DWORD, DWORD>::const_iterator found = bySession.find(Read32(p + 2));
+		if(found == bySession.end())
+		{
+			return;
+		}
+		Client& c = clients[found->second];
+		BYTE flags = p[1];
+		DWORD tick = Read32(p + 6);
+		DWORD base = Read32(p + 10);
+		DWORD offset = ServerProtocol::kUpdateHeader + p[19] * ServerProtocol::kPlayerSize;
+		if(c.latest != ServerProtocol::kNoTick && tick <= c.latest)
+		{
+			stats.staleUpdates++;
+			return;
+		}
+		BYTE* cells = c.mirror[tick % kMirrors];
+		if(flags & ServerProtocol::kUpdateFull)
+		{
+			if(size != offset + Map::NumCells)
+			{
+				return;
+			}
+			memcpy(cells, p + offset, Map::NumCells);
+			stats.fullUpdates++;
+		}
+		else
+		{
+			if(size < offset + 2 || c.mirrorTick[base % kMirrors] != base)
+			{
+				stats.staleUpdates++;
+				return;
+			}
+			DWORD count = Read16(p + offset);
+			if(size != offset + 2 + count * 3)
+			{
+				return;
+			}
+			if(base % kMirrors != tick % kMirrors)
+			{
+				memcpy(cells, c.mirror[base % kMirrors], Map::NumCells);
+			}
+			const BYTE* change = p + offset + 2;
+			for(DWORD i = 0; i < count; i++, change += 3)
+			{
+				DWORD index = Read16(change);
+				if(index < Map::NumCells)
+				{
+					cells[index] = change[2];
+				}
+			}
+		}
+		c.mirrorTick[tick % kMirrors] = tick;
+		c.latest = tick;
+		if(flags & ServerProtocol::kUpdateHash)
+		{
+			stats.hashChecks++;
+			if(ServerProtocol::HashCells(cells) != Read32(p + 14))
+			{
+				stats.hashMismatches++;
+			}
+		}
+	}
+
+	int sock;
+	int timer;
+	int wake;
+	int poll;
+	std::vector<Client> clients;
+	std::unordered_map<DWORD, DWORD> bySession;
+	std::vector<BYTE> receiveBuffer;
+	NetStats stats;
+};
+
+LoadGenerator::LoadGenerator()
+{
+}
+
+LoadGenerator::~LoadGenerator()
+{
+	Stop();
+}
+
+bool LoadGenerator::Start(DWORD serverPort, DWORD numServerWorkers, DWORD numClients, DWORD numThreads, uint64_t seed)
+{
+	for(DWORD i = 0; i < numThreads; i++)
+	{
+		DWORD first = (DWORD) ((uint64_t) numClients * i / numThreads);
+		DWORD end = (DWORD) ((uint64_t) numClients * (i + 1) / numThreads);
+		Thread* thread = new Thread;
+		threads.push_back(thread);
+		if(!thread->Open(serverPort, numServerWorkers, first, end - first, seed))
+		{
+			Stop();
+			return false;
+		}
+	}
+	for(DWORD i = 0; i < numThreads; i++)
+	{
+		Thread* thread = threads[i];
+		thread->thread = std::thread([thread] { thread->Run(); });
+	}
+	return true;
+}
+
+void LoadGenerator::Stop()
+{
+	for(DWORD i = 0; i < threads.size(); i++)
+	{
+		if(threads[i]->thread.joinable())
+		{
+			threads[i]->Stop();
+		}
+		delete threads[i];
+	}
+	threads.clear();
+}
+
+NetStats LoadGenerator::CollectStats(bool clear)
+{
+	NetStats total;
+	for(DWORD i = 0; i < threads.size(); i++)
+	{
+		std::lock_guard<std::mutex> lock(threads[i]->statsMutex);
+		total.Add(threads[i]->published);
+		if(clear)
+		{
+			threads[i]->published.Clear();
+		}
+	}
+	return total;
+}
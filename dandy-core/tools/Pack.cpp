@@ -0,0 +1,120 @@
+// dandy-pack: packs a directory of level files into a level archive, or
+// lists and verifies an existing archive.
+//
+//   dandy-pack DIR OUTPUT      every file in DIR that is exactly one packed
+//                              level long, in name order
+//   dandy-pack --list ARCHIVE
+
+#include "../LevelArchive.h"
+#include "../Map.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static void Usage()
+{
+	fprintf(stderr, "usage: dandy-pack DIR OUTPUT\n       dandy-pack --list ARCHIVE\n");
+}
+
+static int List(const char* path)
+{
+	LevelArchive archive;
+	if(!archive.Open(path))
+	{
+		fprintf(stderr, "%s: not a level archive for a %ux%u map, or a level has no entrance or has it on the outer wall\n", path, Map::Width, Map::Height);
+		return 1;
+	}
+	int result = 0;
+	printf("%-6s %-24s %-7s %-7s %8s %5s %7s %5s\n", "index", "name", "up", "down", "monsters", "gens", "pickups", "locks");
+	for(DWORD i = 0; i < archive.Count(); i++)
+	{
+		LevelInfo info = archive.GetInfo(i);
+		printf("%-6u %-24s %3u,%-3u %3u,%-3u %8u %5u %7u %5u%s\n", i, info.name, info.upX, info.upY,
+			info.downX, info.downY, info.monsters, info.generators, info.pickups, info.locks,
+			archive.Verify(i) ? "" : "  BAD HASH");
+		if(!archive.Verify(i))
+		{
+			result = 1;
+		}
+	}
+	return result;
+}
+
+static int Pack(const char* directory, const char* output)
+{
+	std::vector<std::string> names;
+	std::error_code error;
+	for(std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+	{
+		if(it->is_regular_file() && it->file_size() == Map::PackedLevelSize)
+		{
+			names.push_back(it->path().filename().string());
+		}
+	}
+	if(error)
+	{
+		fprintf(stderr, "%s: %s\n", directory, error.message().c_str());
+		return 1;
+	}
+	std::sort(names.begin(), names.end());
+
+	std::vector<BYTE> packed(names.size() * Map::PackedLevelSize);
+	std::vector<const char*> namePointers;
+	for(size_t i = 0; i < names.size(); i++)
+	{
+		std::string path = std::string(directory) + "/" + names[i];
+		FILE* in = fopen(path.c_str(), "rb");
+		if(!in || fread(&packed[i * Map::PackedLevelSize], 1, Map::PackedLevelSize, in) != Map::PackedLevelSize)
+		{
+			fprintf(stderr, "%s: read failed\n", path.c_str());
+			if(in)
+			{
+				fclose(in);
+			}
+			return 1;
+		}
+		fclose(in);
+		BYTE cells[Map::NumCells];
+		LevelInfo info;
+		Map::DecodeLevel(&packed[i * Map::PackedLevelSize], cells);
+		LevelArchive::Describe(cells, info);
+		if(info.upX == 0xff)
+		{
+			fprintf(stderr, "%s: the level has no entrance\n", path.c_str());
+			return 1;
+		}
+		if(!LevelArchive::IsPlayable(info))
+		{
+			fprintf(stderr, "%s: the entrance (%u,%u) is on the outer wall\n", path.c_str(), info.upX, info.upY);
+			return 1;
+		}
+		namePointers.push_back(names[i].c_str());
+	}
+
+	if(!LevelArchive::Write(output, packed.empty() ? NULL : &packed[0],
+		namePointers.empty() ? NULL : &namePointers[0], (DWORD) names.size()))
+	{
+		fprintf(stderr, "%s: write failed\n", output);
+		return 1;
+	}
+	printf("packed %u levels into %s\n", (DWORD) names.size(), output);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc == 3 && !strcmp(argv[1], "--list"))
+	{
+		return List(argv[2]);
+	}
+	if(argc == 3 && argv[1][0] != '-')
+	{
+		return Pack(argv[1], argv[2]);
+	}
+	Usage();
+	return 1;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../Game.h"
+
+// Scripted stand-in for a human on a game pad: holds a random direction for a
+// random number of ticks, fires most of the time and occasionally eats food
+// or sets off a smart bomb. Driven by its own Random so inputs are
+// reproducible from a seed.
+class RandomPad
+{
+public:
+	RandomPad()
+	{
+		buttons = 0;
+		holdTicks = 0;
+	}
+
+	void Seed(uint64_t seed)
+	{
+		rng.Seed(seed);
+		buttons = 0;
+		holdTicks = 0;
+	}
+
+	BYTE Next()
+	{
+		if(holdTicks == 0)
+		{
+			static const BYTE kSticks[8] =
+			{
+				GamePad::kUp, GamePad::kUp | GamePad::kRight, GamePad::kRight, GamePad::kDown | GamePad::kRight,
+				GamePad::kDown, GamePad::kDown | GamePad::kLeft, GamePad::kLeft, GamePad::kUp | GamePad::kLeft
+			};
+			buttons = kSticks[rng.Get(8)];
+			if(rng.Get(4) != 0)
+			{
+				buttons |= GamePad::kA;
+			}
+			holdTicks = 6 + rng.Get(60);
+		}
+		--holdTicks;
+		BYTE result = buttons;
+		DWORD r = rng.Get(256);
+		if(r == 0)
+		{
+			result |= GamePad::kB;
+		}
+		else if(r == 1)
+		{
+			result |= GamePad::kC;
+		}
+		return result;
+	}
+
+	Random rng;
+	BYTE buttons;
+	DWORD holdTicks;
+};
@@ -0,0 +1,253 @@
+// dandy-replay: plays a replay file recorded by dandy-sim --record as fast
+// as possible, reports ticks/sec and checks the final state against the
+// checksum stored when it was recorded, and every keyframe against the
+// world it was taken from. --info only describes the file. --seek T shows
+// the state at the start of tick T; --seeks N times N random seeks against
+// playing from the start, and checks that both reach the same state.
+
+#include "../LevelArchive.h"
+#include "../Replay.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+static const DWORD kNoSeek = 0xffffffff;
+
+static void Usage()
+{
+	fprintf(stderr, "usage: dandy-replay [--info] [--repeat N] [--seek T] [--seeks N] [--levels DIR] [--archive FILE] REPLAY\n");
+}
+
+static void Describe(const Replay& replay, const char* path)
+{
+	std::vector<BYTE> encoded;
+	replay.Encode(encoded);
+	DWORD runs = 0;
+	for(DWORD s = 0; s < Replay::kNumStreams; s++)
+	{
+		runs += (DWORD) replay.streams[s].size();
+	}
+	printf("file        %s\n", path);
+	printf("rules       %s\n", replay.rules == Xbox360Rules::kId ? "360" : "classic");
+	printf("pathing     %s\n", replay.pathing == kPathFlowField ? "flow" : "direct");
+	printf("seed        %llu\n", (unsigned long long) replay.seed);
+	printf("level       %u\n", replay.level);
+	printf("ticks       %u\n", replay.ticks);
+	printf("runs        %u\n", runs);
+	printf("bytes       %u (%.3f per tick per pad)\n", (DWORD) encoded.size(),
+		replay.ticks ? encoded.size() / ((double) replay.ticks * Replay::kNumPads) : 0.0);
+	printf("checksum    %016llx\n", (unsigned long long) replay.checksum);
+	if(!replay.keyframes.empty())
+	{
+		// Keyframes go last, so the file without them is the streams.
+		Replay inputs = replay;
+		inputs.keyframes.clear();
+		inputs.keyframeTicks.clear();
+		std::vector<BYTE> streams;
+		inputs.Encode(streams);
+		DWORD keyBytes = (DWORD) (encoded.size() - streams.size());
+		printf("keyframes   %u every %u ticks, %u bytes (%.0f each, %u raw)\n", (DWORD) replay.keyframes.size(),
+			replay.keyframeInterval, keyBytes, keyBytes / (double) replay.keyframes.size(), Replay::kStateSize);
+	}
+}
+
+template<class Rules>
+static void Report(const GameT<Rules>& game)
+{
+	printf("level       %u\n", game.world.level);
+	printf("checksum    %016llx\n", (unsigned long long) game.world.Checksum());
+}
+
+template<class Rules>
+static int Play(const Replay& replay, DWORD repeat)
+{
+	static GameT<Rules> game;
+	double seconds = 0;
+	for(DWORD r = 0; r < repeat; r++)
+	{
+		replay.Begin(game);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		replay.Play(game);
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	uint64_t checksum = game.world.Checksum();
+	double ticks = (double) replay.ticks * repeat;
+	printf("ticks       %.0f\n", ticks);
+	printf("seconds     %.3f\n", seconds);
+	printf("ticks/sec   %.0f\n", ticks / seconds);
+	Report(game);
+	if(replay.checksum && checksum != replay.checksum)
+	{
+		printf("MISMATCH: recorded %016llx\n", (unsigned long long) replay.checksum);
+		return 1;
+	}
+
+	// Once more, stopping at each keyframe to compare it with the world.
+	replay.Begin(game);
+	Replay::Cursor cursor(replay);
+	std::vector<BYTE> state(Replay::kStateSize);
+	for(size_t k = 0; k < replay.keyframes.size(); k++)
+	{
+		replay.PlayTo(game, cursor, replay.keyframeTicks[k]);
+		game.world.WriteState(state.data());
+		if(state != replay.keyframes[k])
+		{
+			printf("MISMATCH: keyframe at tick %u\n", replay.keyframeTicks[k]);
+			return 1;
+		}
+	}
+	if(!replay.keyframes.empty())
+	{
+		printf("keyframes   %u match\n", (DWORD) replay.keyframes.size());
+	}
+	return 0;
+}
+
+template<class Rules>
+static int Seek(const Replay& replay, DWORD tick)
+{
+	static GameT<Rules> game;
+	Replay::Cursor cursor(replay);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	replay.Seek(game, cursor, tick);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("tick        %u\n", tick);
+	printf("from        %d\n", replay.FindKeyframe(tick) < 0 ? 0 : (int) replay.keyframeTicks[replay.FindKeyframe(tick)]);
+	printf("usec        %.1f\n", seconds * 1e6);
+	Report(game);
+	return 0;
+}
+
+// Random seeks, each timed from the nearest keyframe and from the start.
+template<class Rules>
+static int Seeks(const Replay& replay, DWORD count)
+{
+	static GameT<Rules> keyed;
+	static GameT<Rules> linear;
+	Random rng(replay.seed);
+	double keyedSeconds = 0;
+	double linearSeconds = 0;
+	for(DWORD i = 0; i < count; i++)
+	{
+		DWORD tick = rng.Get(replay.ticks + 1);
+		Replay::Cursor keyedCursor(replay);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		replay.Seek(keyed, keyedCursor, tick);
+		std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+		Replay::Cursor linearCursor(replay);
+		replay.Begin(linear);
+		replay.PlayTo(linear, linearCursor, tick);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		keyedSeconds += std::chrono::duration<double>(middle - start).count();
+		linearSeconds += std::chrono::duration<double>(end - middle).count();
+		if(keyed.world.Checksum() != linear.world.Checksum())
+		{
+			printf("MISMATCH: seeking to tick %u\n", tick);
+			return 1;
+		}
+	}
+	printf("seeks       %u\n", count);
+	printf("keyframes   %u every %u ticks\n", (DWORD) replay.keyframes.size(), replay.keyframeInterval);
+	printf("usec/seek   %.1f from a keyframe, %.1f from the start\n", keyedSeconds * 1e6 / count, linearSeconds * 1e6 / count);
+	return 0;
+}
+
+template<class Rules>
+static int Run(const Replay& replay, DWORD repeat, DWORD seekTick, DWORD seeks)
+{
+	if(seekTick != kNoSeek)
+	{
+		return Seek<Rules>(replay, seekTick);
+	}
+	if(seeks)
+	{
+		return Seeks<Rules>(replay, seeks);
+	}
+	return Play<Rules>(replay, repeat);
+}
+
+int main(int argc, char** argv)
+{
+	bool info = false;
+	DWORD repeat = 1;
+	DWORD seekTick = kNoSeek;
+	DWORD seeks = 0;
+	const char* path = NULL;
+	static LevelArchive archive;
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--info"))
+		{
+			info = true;
+		}
+		else if(!strcmp(argv[i], "--repeat") && i + 1 < argc)
+		{
+			repeat = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--seek") && i + 1 < argc)
+		{
+			seekTick = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--seeks") && i + 1 < argc)
+		{
+			seeks = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--levels") && i + 1 < argc)
+		{
+			Map::SetLevelDirectory(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "--archive") && i + 1 < argc)
+		{
+			if(!archive.Open(argv[++i]))
+			{
+				fprintf(stderr, "%s: not a level archive\n", argv[i]);
+				return 1;
+			}
+			Map::SetLevelArchive(&archive);
+		}
+		else if(argv[i][0] != '-' && !path)
+		{
+			path = argv[i];
+		}
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+	if(!path || repeat == 0)
+	{
+		Usage();
+		return 1;
+	}
+
+	Replay replay;
+	if(!replay.Read(path))
+	{
+		fprintf(stderr, "%s: not a replay file\n", path);
+		return 1;
+	}
+	if(info)
+	{
+		Describe(replay, path);
+		return 0;
+	}
+	if(seekTick != kNoSeek && seekTick > replay.ticks)
+	{
+		fprintf(stderr, "%s: only %u ticks\n", path, replay.ticks);
+		return 1;
+	}
+
+	Map::PreloadLevels();
+	if(replay.rules == Xbox360Rules::kId)
+	{
+		return Run<Xbox360Rules>(replay, repeat, seekTick, seeks);
+	}
+	if(replay.rules == ClassicRules::kId)
+	{
+		return Run<ClassicRules>(replay, repeat, seekTick, seeks);
+	}
+	fprintf(stderr, "%s: unknown rules %u\n", path, replay.rules);
+	return 1;
+}
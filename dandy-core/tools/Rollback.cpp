@@ -0,0 +1,218 @@
+// dandy-rollback: plays one online co-op game between several rollback
+// peers over a simulated network with latency, jitter and packet loss,
+// each peer driving its own player with scripted input. Once every input
+// has arrived, every peer's world must match a game stepped directly with
+// all the inputs; the checksums are printed and compared.
+
+#include "../Loopback.h"
+#include "../Rollback.h"
+#include "RandomPad.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+static void Usage()
+{
+	fprintf(stderr,
+		"usage: dandy-rollback [--seed N] [--input-seed N] [--frames N] [--peers N] [--rules classic|360]\n"
+		"                      [--latency MS] [--jitter MS] [--loss PERCENT] [--net-seed N] [--levels DIR]\n");
+}
+
+struct RollbackOptions
+{
+	uint64_t seed;
+	uint64_t inputSeed;
+	uint64_t netSeed;
+	DWORD frames;
+	DWORD peers;
+	DWORD latency;
+	DWORD jitter;
+	DWORD loss;
+};
+
+static const DWORD kFrameMicros = 16667;
+
+template<class Rules>
+static int Run(const RollbackOptions& options)
+{
+	typedef RollbackSessionT<Rules> Session;
+	static Session sessions[World::PlayerCount];
+	RandomPad pads[World::PlayerCount];
+	BYTE pending[World::PlayerCount];
+	bool havePending[World::PlayerCount];
+	std::vector<BYTE> inputs[World::PlayerCount];
+	LoopbackNetwork net(options.peers, options.netSeed);
+	net.SetLatency(options.latency * 1000, options.jitter * 1000);
+	net.SetLoss(options.loss);
+
+	for(DWORD i = 0; i < options.peers; i++)
+	{
+		sessions[i].Start(options.seed, i, options.peers);
+		pads[i].Seed(options.inputSeed * World::PlayerCount + i);
+		havePending[i] = false;
+	}
+
+	std::vector<BYTE> packet;
+	BYTE out[Session::kMaxPacketSize];
+	double maxFrameSeconds = 0;
+	DWORD rounds = 0;
+	for(;;)
+	{
+		bool running = false;
+		bool synced = true;
+		for(DWORD i = 0; i < options.peers; i++)
+		{
+			Session& s = sessions[i];
+			DWORD from;
+			while(net.Receive(i, packet, from))
+			{
+				s.ReadPacket(packet.data(), (DWORD) packet.size());
+			}
+			if(s.frame < options.frames)
+			{
+				running = true;
+				if(!havePending[i])
+				{
+					pending[i] = pads[i].Next();
+					havePending[i] = true;
+				}
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				if(s.AdvanceFrame(pending[i]))
+				{
+					inputs[i].push_back(pending[i]);
+					havePending[i] = false;
+				}
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				maxFrameSeconds = std::max(maxFrameSeconds, seconds);
+			}
+			synced &= s.SyncFrame() == options.frames;
+			for(DWORD j = 0; j < options.peers; j++)
+			{
+				if(j != i)
+				{
+					net.Send(i, j, out, s.WritePacket(j, out));
+				}
+			}
+		}
+		net.Advance(kFrameMicros);
+		if(!running && synced)
+		{
+			break;
+		}
+		if(++rounds > options.frames * 100 + 10000)
+		{
+			fprintf(stderr, "peers did not converge\n");
+			return 1;
+		}
+	}
+
+	static GameT<Rules> reference;
+	for(DWORD p = 0; p < World::PlayerCount; p++)
+	{
+		reference.SetButtons(p, 0);
+		reference.SetConnected(p, p < options.peers);
+	}
+	reference.Start(options.seed);
+	for(DWORD f = 0; f < options.frames; f++)
+	{
+		for(DWORD p = 0; p < options.peers; p++)
+		{
+			reference.SetButtons(p, inputs[p][f]);
+		}
+		reference.Step();
+	}
+	uint64_t expected = reference.world.Checksum();
+
+	printf("frames      %u\n", options.frames);
+	printf("packets     %u sent, %u dropped\n", net.sent, net.dropped);
+	printf("%-6s %8s %10s %10s %8s %18s\n", "peer", "stalls", "rollbacks", "resim avg", "max", "checksum");
+	int result = 0;
+	for(DWORD i = 0; i < options.peers; i++)
+	{
+		Session& s = sessions[i];
+		s.Synchronize();
+		uint64_t checksum = s.game.world.Checksum();
+		printf("%-6u %8u %10u %10.2f %8u   %016llx%s\n", i, s.stats.stalls, s.stats.rollbacks,
+			s.stats.rollbacks ? s.stats.resimulated / (double) s.stats.rollbacks : 0.0,
+			s.stats.maxResimulated, (unsigned long long) checksum, checksum == expected ? "" : "  MISMATCH");
+		if(checksum != expected)
+		{
+			result = 1;
+		}
+	}
+	printf("reference                                         %016llx\n", (unsigned long long) expected);
+	printf("slowest frame %.1f us (budget %.1f us)\n", maxFrameSeconds * 1e6, kFrameMicros / 1.0);
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	RollbackOptions options;
+	options.seed = 1;
+	options.inputSeed = 2;
+	options.netSeed = 3;
+	options.frames = 3600;
+	options.peers = 2;
+	options.latency = 60;
+	options.jitter = 20;
+	options.loss = 5;
+	bool xbox360 = false;
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--seed") && i + 1 < argc)
+		{
+			options.seed = strtoull(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--input-seed") && i + 1 < argc)
+		{
+			options.inputSeed = strtoull(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--net-seed") && i + 1 < argc)
+		{
+			options.netSeed = strtoull(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--frames") && i + 1 < argc)
+		{
+			options.frames = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--peers") && i + 1 < argc)
+		{
+			options.peers = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--latency") && i + 1 < argc)
+		{
+			options.latency = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--jitter") && i + 1 < argc)
+		{
+			options.jitter = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--loss") && i + 1 < argc)
+		{
+			options.loss = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--rules") && i + 1 < argc)
+		{
+			xbox360 = !strcmp(argv[++i], "360");
+		}
+		else if(!strcmp(argv[i], "--levels") && i + 1 < argc)
+		{
+			Map::SetLevelDirectory(argv[++i]);
+		}
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+	if(options.peers < 1 || options.peers > World::PlayerCount || options.loss >= 100)
+	{
+		Usage();
+		return 1;
+	}
+
+	Map::PreloadLevels();
+
+	return xbox360 ? Run<Xbox360Rules>(options) : Run<ClassicRules>(options);
+}
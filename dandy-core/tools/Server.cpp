@@ -0,0 +1,493 @@
+#include "Server.h"
+
+#include <chrono>
+#include <mutex>
+#include <string.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+static const DWORD kTickNanos = 16666667;
+static const DWORD kBatch = 64;
+static const DWORD kMaxCatchUp = 4;
+
+int OpenUdpSocket(DWORD port, bool loopbackOnly)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(fd < 0)
+	{
+		return -1;
+	}
+	int size = 4 << 20;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((uint16_t) port);
+	address.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+	if(bind(fd, (const sockaddr*) &address, sizeof(address)) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int OpenTickTimer()
+{
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if(fd < 0)
+	{
+		return -1;
+	}
+	itimerspec spec;
+	spec.it_interval.tv_sec = 0;
+	spec.it_interval.tv_nsec = kTickNanos;
+	spec.it_value = spec.it_interval;
+	timerfd_settime(fd, 0, &spec, NULL);
+	return fd;
+}
+
+static uint64_t NanosSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One epoll loop and the sessions it owns.
+class GameServer::Worker
+{
+public:
+	Worker()
+	{
+		sock = -1;
+		timer = -1;
+		wake = -1;
+		poll = -1;
+		tick = 0;
+		numSessions = 0;
+		numSends = 0;
+		sendBuffer.resize(kBatch * ServerProtocol::kMaxUpdateSize);
+	}
+
+	~Worker()
+	{
+		for(std::unordered_map<DWORD, Session*>::iterator it = sessions.begin(); it != sessions.end(); ++it)
+		{
+			delete it->second;
+		}
+		int fds[] = { sock, timer, wake, poll };
+		for(DWORD i = 0; i < 4; i++)
+		{
+			if(fds[i] >= 0)
+			{
+				close(fds[i]);
+			}
+		}
+	}
+
+	bool Open(DWORD port, bool loopbackOnly)
+	{
+		sock = OpenUdpSocket(port, loopbackOnly);
+		timer = OpenTickTimer();
+		wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		poll = epoll_create1(EPOLL_CLOEXEC);
+		if(sock < 0 || timer < 0 || wake < 0 || poll < 0)
+		{
+			return false;
+		}
+		int fds[] = { sock, timer, wake };
+		for(DWORD i = 0; i < 3; i++)
+		{
+			epoll_event event;
+			event.events = EPOLLIN;
+			event.data.fd = fds[i];
+			epoll_ctl(poll, EPOLL_CTL_ADD, fds[i], &event);
+		}
+		return true;
+	}
+
+	void Run()
+	{
+		for(;;)
+		{
+			epoll_event events[4];
+			int n = epoll_wait(poll, events, 4, -1);
+			if(n < 0 && errno != EINTR)
+			{
+				return;
+			}
+			for(int i = 0; i < n; i++)
+			{
+				int fd = events[i].data.fd;
+				if(fd == wake)
+				{
+					return;
+				}
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				if(fd == sock)
+				{
+					Receive();
+				}
+				else if(fd == timer)
+				{
+					uint64_t expirations = 0;
+					if(read(timer, &expirations, sizeof(expirations)) == sizeof(expirations) && expirations)
+					{
+						stats.ticks += expirations;
+						stats.lateTicks += expirations - 1;
+						for(uint64_t t = 0; t < std::min<uint64_t>(expirations, kMaxCatchUp); t++)
+						{
+							Tick();
+						}
+					}
+				}
+				stats.busyNanos += NanosSince(start);
+			}
+			std::lock_guard<std::mutex> lock(statsMutex);
+			published.Add(stats);
+			stats.Clear();
+		}
+	}
+
+	void Stop()
+	{
+		uint64_t one = 1;
+		if(write(wake, &one, sizeof(one)) != sizeof(one))
+		{
+			MyDebugBreak();
+		}
+		thread.join();
+	}
+
+	std::thread thread;
+	std::mutex statsMutex;
+	NetStats published;
+	std::atomic<DWORD> numSessions;
+
+private:
+	static const DWORD kHistory = 16;
+
+	struct Session
+	{
+		Game game;
+		DWORD id;
+		DWORD tick;
+		DWORD lastInput;	// Worker tick of the last input
+		bool joined[World::PlayerCount];
+		sockaddr_in address[World::PlayerCount];
+		DWORD ackTick[World::PlayerCount];
+		BYTE buttons[World::PlayerCount];
+		Map::Snapshot history[kHistory];	// The map after session tick t, at t % kHistory
+	};
+
+	void Receive()
+	{
+		BYTE buffers[kBatch][64];
+		iovec iov[kBatch];
+		sockaddr_in from[kBatch];
+		mmsghdr messages[kBatch];
+		for(;;)
+		{
+			for(DWORD i = 0; i < kBatch; i++)
+			{
+				iov[i].iov_base = buffers[i];
+				iov[i].iov_len = sizeof(buffers[i]);
+				memset(&messages[i], 0, sizeof(messages[i]));
+				messages[i].msg_hdr.msg_iov = &iov[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+				messages[i].msg_hdr.msg_name = &from[i];
+				messages[i].msg_hdr.msg_namelen = sizeof(from[i]);
+			}
+			int n = recvmmsg(sock, messages, kBatch, MSG_DONTWAIT, NULL);
+			if(n <= 0)
+			{
+				return;
+			}
+			for(int i = 0; i < n; i++)
+			{
+				stats.packetsIn++;
+				stats.bytesIn += messages[i].msg_len;
+				HandleInput(buffers[i], messages[i].msg_len, from[i]);
+			}
+			if((DWORD) n < kBatch)
+			{
+				return;
+			}
+		}
+	}
+
+	void HandleInput(const BYTE* p, DWORD size, const sockaddr_in& from)
+	{
+		if(size != ServerProtocol::kInputSize || p[0] != ServerProtocol::kInput || p[1] >= World::PlayerCount)
+		{
+			return;
+		}
+		DWORD player = p[1];
+		DWORD id = Read32(p + 2);
+		DWORD ack = Read32(p + 6);
+		Session*& s = sessions[id];
+		if(!s)
+		{
+			s = new Session;
+			s->id = id;
+			s->tick = 0;
+			for(DWORD i = 0; i < World::PlayerCount; i++)
+			{
+				s->joined[i] = false;
+				s->ackTick[i] = ServerProtocol::kNoTick;
+				s->buttons[i] = 0;
+			}
+			s->game.Start(Random::Mix(id));
+			s->game.world.map.Save(s->history[0]);
+			numSessions.store((DWORD) sessions.size(), std::memory_order_relaxed);
+		}
+		s->joined[player] = true;
+		s->address[player] = from;
+		s->lastInput = tick;
+		s->buttons[player] = p[10];
+		if(ack != ServerProtocol::kNoTick && ack <= s->tick
+			&& (s->ackTick[player] == ServerProtocol::kNoTick || ack > s->ackTick[player]))
+		{
+			s->ackTick[player] = ack;
+		}
+	}
+
+	void Tick()
+	{
+		++tick;
+		for(std::unordered_map<DWORD, Session*>::iterator it = sessions.begin(); it != sessions.end(); )
+		{
+			Session* s = it->second;
+			if(tick - s->lastInput > kIdleTicks)
+			{
+				delete s;
+				it = sessions.erase(it);
+				continue;
+			}
+			for(DWORD p = 0; p < World::PlayerCount; p++)
+			{
+				s->game.SetButtons(p, s->buttons[p]);
+			}
+			s->game.Step();
+			++s->tick;
+			s->game.world.map.Save(s->history[s->tick % kHistory]);
+			++stats.sessionTicks;
+			for(DWORD p = 0; p < World::PlayerCount; p++)
+			{
+				if(s->joined[p])
+				{
+					if(numSends == kBatch)
+					{
+						Flush();
+					}
+					BYTE* out = &sendBuffer[numSends * ServerProtocol::kMaxUpdateSize];
+					sendSize[numSends] = WriteUpdate(*s, p, out);
+					sendTo[numSends] = s->address[p];
+					++numSends;
+				}
+			}
+			++it;
+		}
+		Flush();
+		numSessions.store((DWORD) sessions.size(), std::memory_order_relaxed);
+	}
+
+	// Cells are sent as changes against the newest tick the client said it
+	// holds, found by comparing only the rows the two snapshots do not
+	// share; all of them if that tick is too old or the changes would not
+	// be smaller.
+	DWORD WriteUpdate(const Session& s, DWORD player, BYTE* out)
+	{
+		const World& world = s.game.world;
+		const BYTE* cells = world.map.Cell;
+		BYTE flags = 0;
+		DWORD hash = 0;
+		if(s.tick % ServerProtocol::kHashInterval == 0)
+		{
+			flags |= ServerProtocol::kUpdateHash;
+			hash = ServerProtocol::HashCells(cells);
+		}
+		out[0] = ServerProtocol::kUpdate;
+		Write32(out + 2, s.id);
+		Write32(out + 6, s.tick);
+		Write32(out + 14, hash);
+		out[18] = (BYTE) world.level;
+		out[19] = (BYTE) world.numPlayers;
+		DWORD size = ServerProtocol::kUpdateHeader;
+		for(DWORD p = 0; p < world.numPlayers; p++)
+		{
+			ServerProtocol::WritePlayer(out + size, world.player[p]);
+			size += ServerProtocol::kPlayerSize;
+		}
+
+		DWORD base = s.ackTick[player];
+		bool delta = base != ServerProtocol::kNoTick && s.tick - base < kHistory;
+		if(delta)
+		{
+			const Map::Snapshot& before = s.history[base % kHistory];
+			const Map::Snapshot& after = s.history[s.tick % kHistory];
+			DWORD end = size + 2;
+			DWORD limit = size + Map::NumCells;
+			WORD count = 0;
+			for(DWORD row = 0; row < Map::Height && delta; row++)
+			{
+				const Map::Snapshot::Chunk* a = before.Get(row);
+				const Map::Snapshot::Chunk* b = after.Get(row);
+				if(a == b)
+				{
+					continue;
+				}
+				for(DWORD x = 0; x < Map::Width; x++)
+				{
+					if(a->cells[x] != b->cells[x])
+					{
+						if(end + 3 > limit)
+						{
+							delta = false;
+							break;
+						}
+						Write16(out + end, row * Map::Width + x);
+						out[end + 2] = b->cells[x];
+						end += 3;
+						++count;
+					}
+				}
+			}
+			if(delta)
+			{
+				Write16(out + size, count);
+				size = end;
+			}
+		}
+		if(!delta)
+		{
+			flags |= ServerProtocol::kUpdateFull;
+			base = ServerProtocol::kNoTick;
+			memcpy(out + size, cells, Map::NumCells);
+			size += Map::NumCells;
+			++stats.fullUpdates;
+		}
+		out[1] = flags;
+		Write32(out + 10, base);
+		return size;
+	}
+
+	void Flush()
+	{
+		iovec iov[kBatch];
+		mmsghdr messages[kBatch];
+		for(DWORD i = 0; i < numSends; i++)
+		{
+			iov[i].iov_base = &sendBuffer[i * ServerProtocol::kMaxUpdateSize];
+			iov[i].iov_len = sendSize[i];
+			memset(&messages[i], 0, sizeof(messages[i]));
+			messages[i].msg_hdr.msg_iov = &iov[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+			messages[i].msg_hdr.msg_name = &sendTo[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(sendTo[i]);
+		}
+		DWORD sent = 0;
+		while(sent < numSends)
+		{
+			int n = sendmmsg(sock, messages + sent, numSends - sent, 0);
+			if(n <= 0)
+			{
+				// A full socket buffer drops the rest, as the network would.
+				break;
+			}
+			for(int i = 0; i < n; i++)
+			{
+				stats.packetsOut++;
+				stats.bytesOut += sendSize[sent + i];
+			}
+			sent += n;
+		}
+		numSends = 0;
+	}
+
+	int sock;
+	int timer;
+	int wake;
+	int poll;
+	DWORD tick;
+	std::unordered_map<DWORD, Session*> sessions;
+	NetStats stats;
+
+	std::vector<BYTE> sendBuffer;
+	DWORD sendSize[kBatch];
+	sockaddr_in sendTo[kBatch];
+	DWORD numSends;
+};
+
+GameServer::GameServer()
+{
+}
+
+GameServer::~GameServer()
+{
+	Stop();
+}
+
+bool GameServer::Start(DWORD basePort, DWORD numWorkers, bool loopbackOnly)
+{
+	for(DWORD i = 0; i < numWorkers; i++)
+	{
+		Worker* worker = new Worker;
+		workers.push_back(worker);
+		if(!worker->Open(basePort + i, loopbackOnly))
+		{
+			Stop();
+			return false;
+		}
+	}
+	for(DWORD i = 0; i < numWorkers; i++)
+	{
+		Worker* worker = workers[i];
+		worker->thread = std::thread([worker] { worker->Run(); });
+	}
+	return true;
+}
+
+void GameServer::Stop()
+{
+	for(DWORD i = 0; i < workers.size(); i++)
+	{
+		if(workers[i]->thread.joinable())
+		{
+			workers[i]->Stop();
+		}
+		delete workers[i];
+	}
+	workers.clear();
+}
+
+NetStats GameServer::CollectStats(bool clear)
+{
+	NetStats total;
+	for(DWORD i = 0; i < workers.size(); i++)
+	{
+		std::lock_guard<std::mutex> lock(workers[i]->statsMutex);
+		total.Add(workers[i]->published);
+		if(clear)
+		{
+			workers[i]->published.Clear();
+		}
+	}
+	return total;
+}
+
+DWORD GameServer::SessionCount() const
+{
+	DWORD count = 0;
+	for(DWORD i = 0; i < workers.size(); i++)
+	{
+		count += workers[i]->numSessions.load(std::memory_order_relaxed);
+	}
+	return count;
+}
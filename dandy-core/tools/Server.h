@@ -0,0 +1,116 @@
+#pragma once
+
+#include "ServerProtocol.h"
+
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <netinet/in.h>
+
+// Non-blocking UDP socket bound to port (0 for any) on the loopback or
+// any address, and a timerfd firing every 1/60 s. Both return -1 on
+// failure.
+int OpenUdpSocket(DWORD port, bool loopbackOnly);
+int OpenTickTimer();
+
+// Counters a worker or load generator thread publishes for the report.
+struct NetStats
+{
+	NetStats()
+	{
+		Clear();
+	}
+
+	void Clear()
+	{
+		ticks = 0;
+		lateTicks = 0;
+		sessionTicks = 0;
+		busyNanos = 0;
+		packetsIn = 0;
+		packetsOut = 0;
+		bytesIn = 0;
+		bytesOut = 0;
+		fullUpdates = 0;
+		staleUpdates = 0;
+		hashChecks = 0;
+		hashMismatches = 0;
+	}
+
+	void Add(const NetStats& other)
+	{
+		ticks += other.ticks;
+		lateTicks += other.lateTicks;
+		sessionTicks += other.sessionTicks;
+		busyNanos += other.busyNanos;
+		packetsIn += other.packetsIn;
+		packetsOut += other.packetsOut;
+		bytesIn += other.bytesIn;
+		bytesOut += other.bytesOut;
+		fullUpdates += other.fullUpdates;
+		staleUpdates += other.staleUpdates;
+		hashChecks += other.hashChecks;
+		hashMismatches += other.hashMismatches;
+	}
+
+	uint64_t ticks;			// Timer ticks handled
+	uint64_t lateTicks;		// Timer ticks that found an earlier one still pending
+	uint64_t sessionTicks;		// Game steps (server) or client frames (load generator)
+	uint64_t busyNanos;		// Time spent in tick handling
+	uint64_t packetsIn;
+	uint64_t packetsOut;
+	uint64_t bytesIn;
+	uint64_t bytesOut;
+	uint64_t fullUpdates;
+	uint64_t staleUpdates;		// Updates on a base the client no longer holds
+	uint64_t hashChecks;
+	uint64_t hashMismatches;
+};
+
+// Dedicated headless server: each worker thread owns one UDP socket on
+// port base + index, a 60 Hz timerfd and every session whose id maps to
+// it, all driven by one epoll loop. Nothing is shared between workers, so
+// they scale with cores.
+class GameServer
+{
+public:
+	GameServer();
+	~GameServer();
+
+	// Binds every worker's socket on the loopback (or any) address and
+	// starts the threads. Returns false if a socket could not be bound.
+	bool Start(DWORD basePort, DWORD numWorkers, bool loopbackOnly);
+	void Stop();
+
+	// Sums the workers' counters; with clear, starts a new measuring period.
+	NetStats CollectStats(bool clear);
+	DWORD SessionCount() const;
+
+	// A session nobody has sent input to for this many ticks is dropped.
+	static const DWORD kIdleTicks = 5 * 60;
+
+private:
+	class Worker;
+	std::vector<Worker*> workers;
+};
+
+// Simulated clients for load testing: numClients sessions of one player
+// each, split across threads, each sending scripted pad input every 1/60 s
+// and rebuilding the map from the updates it receives.
+class LoadGenerator
+{
+public:
+	LoadGenerator();
+	~LoadGenerator();
+
+	bool Start(DWORD serverPort, DWORD numServerWorkers, DWORD numClients, DWORD numThreads, uint64_t seed);
+	void Stop();
+
+	NetStats CollectStats(bool clear);
+
+private:
+	class Thread;
+	std::vector<Thread*> threads;
+};
@@ -0,0 +1,168 @@
+// dandy-server: dedicated headless game server. Each worker thread runs an
+// epoll loop over one UDP socket and a 60 Hz timer, and steps every session
+// it owns once per tick. Clients send their pad each frame and get back the
+// players and the cells changed since the last update they acknowledged.
+//
+// --load N also starts N simulated clients on localhost, one session each,
+// and reports what the server sustained; --no-server points them at a
+// server that is already running.
+
+#include "Server.h"
+
+#include <chrono>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+static void Usage()
+{
+	fprintf(stderr,
+		"usage: dandy-server [--port N] [--workers N] [--any] [--seconds N] [--levels DIR]\n"
+		"                    [--load N [--client-threads N] [--no-server] [--seed N]]\n");
+}
+
+static volatile sig_atomic_t gInterrupted = 0;
+
+static void OnSignal(int)
+{
+	gInterrupted = 1;
+}
+
+static void Report(const NetStats& server, const NetStats& load, DWORD sessions, DWORD workers, double seconds, bool haveServer, bool haveLoad)
+{
+	if(haveServer)
+	{
+		double busy = server.busyNanos / (seconds * 1e9 * workers);
+		double nanosPerStep = server.sessionTicks ? server.busyNanos / (double) server.sessionTicks : 0;
+		printf("server      %u sessions on %u workers\n", sessions, workers);
+		printf("  steps/sec       %12.0f\n", server.sessionTicks / seconds);
+		printf("  late ticks      %12llu of %llu\n", (unsigned long long) server.lateTicks, (unsigned long long) server.ticks);
+		printf("  busy            %11.1f%%\n", busy * 100);
+		printf("  ns per step     %12.0f  (receive, step, diff and send)\n", nanosPerStep);
+		if(nanosPerStep > 0)
+		{
+			double perCore = 1e9 / 60 / nanosPerStep;
+			printf("  sessions/core   %12.0f  at 60 Hz, %0.f per 16 cores\n", perCore, perCore * 16);
+		}
+		printf("  bytes/update    %12.1f  (%llu full)\n",
+			server.packetsOut ? server.bytesOut / (double) server.packetsOut : 0.0, (unsigned long long) server.fullUpdates);
+		printf("  out             %12.0f  kB/s\n", server.bytesOut / seconds / 1000);
+	}
+	if(haveLoad)
+	{
+		printf("clients\n");
+		printf("  inputs/sec      %12.0f\n", load.packetsOut / seconds);
+		printf("  updates/sec     %12.0f  (%llu stale)\n", load.packetsIn / seconds, (unsigned long long) load.staleUpdates);
+		printf("  map checks      %12llu  (%llu mismatched)\n",
+			(unsigned long long) load.hashChecks, (unsigned long long) load.hashMismatches);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	DWORD port = 27960;
+	DWORD workers = std::max<DWORD>(1, std::thread::hardware_concurrency());
+	DWORD seconds = 0;
+	DWORD load = 0;
+	DWORD clientThreads = 1;
+	bool any = false;
+	bool runServer = true;
+	uint64_t seed = 1;
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--port") && i + 1 < argc)
+		{
+			port = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--workers") && i + 1 < argc)
+		{
+			workers = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--seconds") && i + 1 < argc)
+		{
+			seconds = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--load") && i + 1 < argc)
+		{
+			load = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--client-threads") && i + 1 < argc)
+		{
+			clientThreads = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--seed") && i + 1 < argc)
+		{
+			seed = strtoull(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--any"))
+		{
+			any = true;
+		}
+		else if(!strcmp(argv[i], "--no-server"))
+		{
+			runServer = false;
+		}
+		else if(!strcmp(argv[i], "--levels") && i + 1 < argc)
+		{
+			Map::SetLevelDirectory(argv[++i]);
+		}
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+	if(workers == 0 || clientThreads == 0 || (!runServer && !load))
+	{
+		Usage();
+		return 1;
+	}
+	if(load && !seconds)
+	{
+		seconds = 10;
+	}
+
+	Map::PreloadLevels();
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+
+	GameServer server;
+	if(runServer && !server.Start(port, workers, !any))
+	{
+		fprintf(stderr, "could not bind ports %u..%u\n", port, port + workers - 1);
+		return 1;
+	}
+	LoadGenerator clients;
+	if(load && !clients.Start(port, workers, load, clientThreads, seed))
+	{
+		fprintf(stderr, "could not start the load generator\n");
+		return 1;
+	}
+
+	// Sessions start on their first input; measure once they are running.
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+	server.CollectStats(true);
+	clients.CollectStats(true);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	DWORD elapsed = 0;
+	while(!gInterrupted && (seconds == 0 || elapsed < seconds))
+	{
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		++elapsed;
+		if(seconds == 0)
+		{
+			printf("%u sessions\n", server.SessionCount());
+			fflush(stdout);
+		}
+	}
+	double measured = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	NetStats serverStats = server.CollectStats(false);
+	NetStats loadStats = clients.CollectStats(false);
+	DWORD sessions = server.SessionCount();
+	clients.Stop();
+	server.Stop();
+
+	Report(serverStats, loadStats, sessions, workers, measured, runServer, load != 0);
+	return loadStats.hashMismatches ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../ByteOrder.h"
+#include "../Game.h"
+
+// Datagrams between dandy-server and its clients, all integers
+// little-endian.
+//
+// Client to server, once per client frame:
+//
+//   input    11 bytes   'P', player, session id, last update tick the
+//                       client holds (kNoTick for none), buttons
+//
+// The first input for an unknown session id starts a game for it. A
+// session's clients must all send to the same port: base port + session
+// id % number of workers.
+//
+// Server to client, once per server tick:
+//
+//   update   'U', flags, session id, tick, base tick, cell hash, level,
+//            player count, then per player x, y, health, food, keys,
+//            bombs, state, dir and score, then either every cell
+//            (kUpdateFull) or a count and (index, value) for each cell
+//            that differs from the client's base tick
+//
+// The hash (FNV-1a of the cells) is sent every kHashInterval ticks so
+// clients can check the map they rebuilt.
+
+struct ServerProtocol
+{
+	static const BYTE kInput = 'P';
+	static const BYTE kUpdate = 'U';
+	static const DWORD kInputSize = 11;
+
+	static const BYTE kUpdateFull = 1;
+	static const BYTE kUpdateHash = 2;
+	static const DWORD kUpdateHeader = 20;
+	static const DWORD kPlayerSize = 12;
+	static const DWORD kMaxUpdateSize = kUpdateHeader + World::PlayerCount * kPlayerSize + Map::NumCells;
+
+	static const DWORD kNoTick = 0xffffffff;
+	static const DWORD kHashInterval = 60;
+
+	static DWORD HashCells(const BYTE* cells)
+	{
+		DWORD h = 2166136261u;
+		for(DWORD i = 0; i < Map::NumCells; i++)
+		{
+			h = (h ^ cells[i]) * 16777619u;
+		}
+		return h;
+	}
+
+	static void WriteInput(BYTE* p, DWORD session, DWORD player, DWORD ackTick, BYTE buttons)
+	{
+		p[0] = kInput;
+		p[1] = (BYTE) player;
+		Write32(p + 2, session);
+		Write32(p + 6, ackTick);
+		p[10] = buttons;
+	}
+
+	static void WritePlayer(BYTE* p, const Player& player)
+	{
+		p[0] = player.x;
+		p[1] = player.y;
+		p[2] = player.health;
+		p[3] = player.food;
+		p[4] = player.keys;
+		p[5] = player.bombs;
+		p[6] = (BYTE) player.state;
+		p[7] = (BYTE) player.dir;
+		Write32(p + 8, player.score);
+	}
+};
@@ -0,0 +1,192 @@
+// dandy-sim: steps a single headless game as fast as possible with scripted
+// pad input and reports throughput and a checksum of the final state.
+// Running it twice with the same arguments must print the same checksum.
+// --rules 360 plays the Xbox 360 rules, with --players pads connected
+// (the classic game always starts with two players). --record writes the
+// game's inputs to a replay file for dandy-replay, with a keyframe of the
+// whole world every --keyframe-interval ticks (0 for none) to seek by.
+
+#include "../Game.h"
+#include "../LevelArchive.h"
+#include "../Replay.h"
+#include "RandomPad.h"
+
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+
+static void Usage()
+{
+	fprintf(stderr,
+		"usage: dandy-sim [--seed N] [--input-seed N] [--ticks N] [--monster-threads N] [--pathing direct|flow] [--bitboards] [--rules classic|360] [--players N]\n"
+		"                 [--levels DIR] [--archive FILE] [--record FILE [--keyframe-interval N]]\n");
+}
+
+struct SimOptions
+{
+	uint64_t seed;
+	uint64_t inputSeed;
+	DWORD ticks;
+	DWORD monsterThreads;
+	MonsterPathing pathing;
+	bool bitboards;
+	DWORD players;
+	const char* recordPath;
+	DWORD keyframeInterval;
+};
+
+template<class Rules>
+static void Run(const SimOptions& options)
+{
+	static GameT<Rules> game;
+	// One thread needs no pool, so none is started.
+	std::unique_ptr<ThreadPool> pool;
+	if(options.monsterThreads > 1)
+	{
+		pool.reset(new ThreadPool(options.monsterThreads - 1));
+		game.world.SetMonsterPool(pool.get());
+	}
+	RandomPad pads[World::PlayerCount];
+	for(DWORD i = 0; i < World::PlayerCount; i++)
+	{
+		pads[i].Seed(options.inputSeed * World::PlayerCount + i);
+		game.SetConnected(i, i < options.players);
+	}
+	game.world.SetMonsterPathing(options.pathing);
+	game.world.map.EnableBitboards(options.bitboards);
+	game.Start(options.seed);
+
+	Replay replay;
+	replay.Start(Rules::kId, options.seed, game.world.level, options.pathing);
+	BYTE connected = 0;
+	for(DWORD i = 0; i < World::PlayerCount; i++)
+	{
+		connected |= (game.connected[i] ? 1 : 0) << i;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(DWORD t = 0; t < options.ticks; t++)
+	{
+		BYTE buttons[World::PlayerCount];
+		for(DWORD i = 0; i < World::PlayerCount; i++)
+		{
+			buttons[i] = pads[i].Next();
+			game.SetButtons(i, buttons[i]);
+		}
+		if(options.recordPath)
+		{
+			if(options.keyframeInterval && t % options.keyframeInterval == 0)
+			{
+				replay.AddKeyframe(game.world, options.keyframeInterval);
+			}
+			replay.AddTick(buttons, connected);
+		}
+		game.Step();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("ticks       %u\n", options.ticks);
+	printf("seconds     %.3f\n", seconds);
+	printf("ticks/sec   %.0f\n", options.ticks / seconds);
+	printf("level       %u\n", game.world.level);
+	printf("checksum    %016llx\n", (unsigned long long) game.world.Checksum());
+
+	if(options.recordPath)
+	{
+		replay.checksum = game.world.Checksum();
+		if(!replay.Write(options.recordPath))
+		{
+			fprintf(stderr, "%s: could not write the replay\n", options.recordPath);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SimOptions options;
+	options.seed = 1;
+	options.inputSeed = 2;
+	options.ticks = 1000000;
+	options.monsterThreads = 1;
+	options.pathing = kPathDirect;
+	options.bitboards = false;
+	options.players = 2;
+	options.recordPath = NULL;
+	options.keyframeInterval = 3600;
+	bool xbox360 = false;
+	static LevelArchive archive;
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--seed") && i + 1 < argc)
+		{
+			options.seed = strtoull(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--input-seed") && i + 1 < argc)
+		{
+			options.inputSeed = strtoull(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--ticks") && i + 1 < argc)
+		{
+			options.ticks = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--monster-threads") && i + 1 < argc)
+		{
+			options.monsterThreads = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--pathing") && i + 1 < argc)
+		{
+			options.pathing = !strcmp(argv[++i], "flow") ? kPathFlowField : kPathDirect;
+		}
+		else if(!strcmp(argv[i], "--bitboards"))
+		{
+			options.bitboards = true;
+		}
+		else if(!strcmp(argv[i], "--rules") && i + 1 < argc)
+		{
+			xbox360 = !strcmp(argv[++i], "360");
+		}
+		else if(!strcmp(argv[i], "--players") && i + 1 < argc)
+		{
+			options.players = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--record") && i + 1 < argc)
+		{
+			options.recordPath = argv[++i];
+		}
+		else if(!strcmp(argv[i], "--keyframe-interval") && i + 1 < argc)
+		{
+			options.keyframeInterval = (DWORD) strtoul(argv[++i], NULL, 0);
+		}
+		else if(!strcmp(argv[i], "--levels") && i + 1 < argc)
+		{
+			Map::SetLevelDirectory(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "--archive") && i + 1 < argc)
+		{
+			if(!archive.Open(argv[++i]))
+			{
+				fprintf(stderr, "%s: not a level archive\n", argv[i]);
+				return 1;
+			}
+			Map::SetLevelArchive(&archive);
+		}
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	Map::PreloadLevels();
+
+	if(xbox360)
+	{
+		Run<Xbox360Rules>(options);
+	}
+	else
+	{
+		Run<ClassicRules>(options);
+	}
+	return 0;
+}